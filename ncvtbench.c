@@ -0,0 +1,606 @@
+#include "vt_scan.h"
+#include "vt_parser.h"
+#include "vt_grid.h"
+#include "vt_utf8.h"
+#include "ncvtproto.h"
+#include <locale.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <stdarg.h>
+
+// Headless benchmarks for the VT parser pieces, and for the whole ncplane_putvt path on an off-screen plane.
+// Usage: ./a.out [corpus files...]   (defaults to the shipped .pattern files)
+//
+// Generated corpora come from a fixed seed, and allocations and plane calls per KB don't depend on timing,
+// so the putvt numbers can be compared between commits as they are.
+
+struct corpus {
+	const char* name;
+	char* data;
+	size_t len;
+};
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int corpus_load(struct corpus* c, const char* path) {
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL) return -1;
+	fseek(fp, 0, SEEK_END);
+	c->len = ftell(fp);
+	rewind(fp);
+	c->data = malloc(c->len);
+	if (c->data == NULL || fread(c->data, 1, c->len, fp) != c->len) {
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+	c->name = path;
+	return 0;
+}
+
+// Plain ASCII log lines, the kind of stuff build logs are made of
+static void corpus_ascii_log(struct corpus* c, size_t len) {
+	static const char* line = "[ 42%] Building C object src/CMakeFiles/notcurses.dir/render.c.o\n";
+	size_t ll = strlen(line);
+	c->name = "generated ascii log";
+	c->data = malloc(len);
+	c->len = len;
+	for (size_t i = 0; i < len; i++) c->data[i] = line[i % ll];
+}
+
+static uint32_t rnd_state = 12345;
+
+static uint32_t rnd(void) {	// xorshift32, the same sequence everywhere
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+static void corpus_printf(struct corpus* c, size_t cap, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+static void corpus_printf(struct corpus* c, size_t cap, const char* fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(c->data + c->len, cap - c->len, fmt, ap);
+	va_end(ap);
+	if (n > 0) c->len += (size_t) n < cap - c->len ? (size_t) n : cap - c->len - 1;
+}
+
+// Full screen repaints of a syntax highlighted 40x120 window, the way vim redraws after a jump:
+// every row is positioned, then written as a few colored spans, with a status line at the bottom
+static void corpus_vim(struct corpus* c, size_t len) {
+	static const char* words[] = { "static", "int", "return", "if", "vt_grid", "(", ");", "{", "}", "->", "size_t", "0" };
+	c->name = "generated vim repaints";
+	c->data = malloc(len);
+	c->len = 0;
+	rnd_state = 12345;
+	while (c->len < len - 256) {
+		corpus_printf(c, len, "\e[H\e[2J");
+		for (int y = 1; y < 40 && c->len < len - 256; y++) {
+			corpus_printf(c, len, "\e[%d;1H\e[38;5;130m%4d \e[m", y, y + (int) (rnd() % 1000));
+			for (int x = 5; x < 100; ) {
+				const char* w = words[rnd() % 12];
+				if (rnd() % 4 == 0) corpus_printf(c, len, "\e[38;5;%um%s\e[m ", 16 + rnd() % 216, w);
+				else corpus_printf(c, len, "%s ", w);
+				x += strlen(w) + 1;
+			}
+		}
+		corpus_printf(c, len, "\e[40;1H\e[38;2;0;0;0;48;2;200;200;200m vt_grid.c [+]%100s\e[m", "");
+	}
+}
+
+// Braille graphs (btop, plotting tools): every cell is a 3 byte codepoint, and colors change every few cells
+static void corpus_braille(struct corpus* c, size_t len) {
+	c->name = "generated braille";
+	c->data = malloc(len);
+	c->len = 0;
+	rnd_state = 12345;
+	while (c->len < len - 64) {
+		for (int x = 0; x < 118 && c->len < len - 64; x++) {
+			if (x % 8 == 0) corpus_printf(c, len, "\e[38;2;%u;%u;0m", rnd() % 256, rnd() % 256);
+			uint32_t cp = 0x2800 + rnd() % 256;
+			corpus_printf(c, len, "%c%c%c", 0xE2, 0xA0 | (cp >> 6 & 3), 0x80 | (cp & 0x3F));
+		}
+		corpus_printf(c, len, "\e[m\r\n");
+	}
+}
+
+// CJK text, the way a Chinese man page or log comes out: 3 byte codepoints, ASCII punctuation now and then
+static void corpus_cjk(struct corpus* c, size_t len) {
+	c->name = "generated CJK";
+	c->data = malloc(len);
+	c->len = 0;
+	rnd_state = 12345;
+	while (c->len < len - 64) {
+		for (int x = 0; x < 50 && c->len < len - 64; x++) {
+			uint32_t cp = 0x4E00 + rnd() % 0x5200;
+			c->len += vt_u8enc(cp, c->data + c->len);
+			if (rnd() % 16 == 0) c->data[c->len++] = ',';
+		}
+		corpus_printf(c, len, "\r\n");
+	}
+}
+
+// Chat log with emoji: ZWJ families, flags, skin tones, and accents written as combining marks.
+// The same few clusters over and over.
+static void corpus_emoji(struct corpus* c, size_t len) {
+	static const char* clusters[] = {
+		"\U0001F468\u200D\U0001F469\u200D\U0001F467", "\U0001F1FA\U0001F1F8", "\U0001F1EF\U0001F1F5",
+		"\U0001F44D\U0001F3FD", "\u2764\uFE0F", "\U0001F602", "e\u0301", "a\u0300", "n\u0303",
+	};
+	c->name = "generated emoji";
+	c->data = malloc(len);
+	c->len = 0;
+	rnd_state = 12345;
+	while (c->len < len - 64) {
+		for (int x = 0; x < 30 && c->len < len - 64; x++) {
+			corpus_printf(c, len, "%s", clusters[rnd() % (sizeof(clusters) / sizeof(*clusters))]);
+			if (rnd() % 4 == 0) corpus_printf(c, len, " ");
+		}
+		corpus_printf(c, len, "\r\n");
+	}
+}
+
+// -------------------- CONTROL BYTE SCANNER
+
+static const char* scan_names[] = { "scalar", "sse2", "avx2" };
+
+// Walks the corpus the way the parser does: skip a run, step over the boundary byte, repeat
+static size_t scan_walk(enum vt_scan_impl impl, const struct corpus* c) {
+	size_t i = 0, stops = 0;
+	while (i < c->len) {
+		i += vt_scan_ctl_impl(impl, c->data + i, c->len - i);
+		i++;
+		stops++;
+	}
+	return stops;
+}
+
+static void bench_scan(const struct corpus* c) {
+	printf("%s (%zu bytes)\n", c->name, c->len);
+	size_t ref = scan_walk(VT_SCAN_SCALAR, c);
+	for (int impl = VT_SCAN_SCALAR; impl <= VT_SCAN_AVX2; impl++) {
+		if (!vt_scan_has(impl)) {
+			printf("  scan %-8s unavailable\n", scan_names[impl]);
+			continue;
+		}
+		size_t iters = 0, stops = 0;
+		double t0 = now(), t;
+		do {
+			stops = scan_walk(impl, c);
+			iters++;
+		} while ((t = now() - t0) < 0.25);
+		printf("  scan %-8s %9.1f MB/s  %6.2f ns/byte  %zu stops%s\n", scan_names[impl],
+			c->len * iters / t / 1e6, t * 1e9 / (c->len * iters), stops,
+			stops == ref ? "" : "  MISMATCH");
+	}
+}
+
+// -------------------- UTF-8
+// Decoding every codepoint with the checking decoder, vs validating ahead and decoding without checks,
+// which is what vt_grid_print does
+
+static volatile uint32_t utf8_sink;	// Keeps the decoding from being optimized away
+
+static size_t utf8_checked(enum vt_scan_impl impl, const struct corpus* c, uint32_t* sum) {
+	const unsigned char* u = (const unsigned char*) c->data;
+	size_t i = 0, n = 0;
+	uint32_t cp;
+
+	(void) impl;	// Nothing to dispatch, it's here to share the signature of utf8_validated
+	while (i < c->len) {
+		i += vt_u8dec(u + i, c->len - i, &cp);
+		*sum += cp;
+		n++;
+	}
+	return n;
+}
+
+static size_t utf8_validated(enum vt_scan_impl impl, const struct corpus* c, uint32_t* sum) {
+	const unsigned char* u = (const unsigned char*) c->data;
+	size_t i = 0, n = 0, valid = 0;
+	uint32_t cp;
+
+	while (i < c->len) {
+		if (i >= valid) valid = i + vt_scan_utf8_impl(impl, c->data + i, c->len - i);
+		if (i < valid) i += vt_u8dec_valid(u + i, &cp);
+		else i += vt_u8dec(u + i, c->len - i, &cp);
+		*sum += cp;
+		n++;
+	}
+	return n;
+}
+
+static void bench_utf8(const struct corpus* c) {
+	static const struct {
+		const char* name;
+		enum vt_scan_impl impl;
+		size_t (*run)(enum vt_scan_impl, const struct corpus*, uint32_t*);
+	} runs[] = {
+		{ "checked", VT_SCAN_SCALAR, utf8_checked },
+		{ "validate scalar", VT_SCAN_SCALAR, utf8_validated },
+		{ "validate avx2", VT_SCAN_AVX2, utf8_validated },
+	};
+
+	for (size_t k = 0; k < sizeof(runs) / sizeof(*runs); k++) {
+		if (!vt_scan_has(runs[k].impl)) continue;
+		size_t iters = 0, n = 0;
+		uint32_t sum = 0;
+		double t0 = now(), t;
+		do {
+			n = runs[k].run(runs[k].impl, c, &sum);
+			iters++;
+		} while ((t = now() - t0) < 0.25);
+		utf8_sink = sum;
+		printf("  utf8 %-16s %9.1f MB/s  %6.2f ns/codepoint  %zu codepoints\n", runs[k].name,
+			c->len * iters / t / 1e6, n ? t * 1e9 / (n * iters) : 0, n);
+	}
+	size_t v = vt_scan_utf8_impl(VT_SCAN_SCALAR, c->data, c->len);
+	for (int impl = VT_SCAN_SSE2; impl <= VT_SCAN_AVX2; impl++) {
+		if (vt_scan_has(impl) && vt_scan_utf8_impl(impl, c->data, c->len) != v)
+			printf("  utf8 %s validation MISMATCH\n", scan_names[impl]);
+	}
+}
+
+// -------------------- CSI TOKENIZER
+
+// The way vt_csi used to do it, for reference: jump over parameter bytes to find the final byte,
+// rewind, then walk the parameters again with a strchr() per parameter.
+// Returns the sequence length past "ESC [", or 0 if it's unfinished.
+static size_t csi_twopass(const char* p, size_t len, int* sum) {
+	size_t pos = 0;
+	while (pos < len && p[pos] >= 0x30 && p[pos] <= 0x3F) pos++;
+	if (pos >= len) return 0;
+	size_t end = pos + 1;
+
+	pos = 0;
+	const char* q = p - 1;	// the '[' preceding the parameters
+	while (strchr(";:?[", *q) != NULL && q < p + end - 1) {
+		int output = -1;
+		q++;
+		while (*q >= '0' && *q <= '9') {
+			if (output < 0) output = 0;
+			output = output * 10 + *q - '0';
+			q++;
+		}
+		*sum += output < 0 ? 0 : output;
+	}
+	return end;
+}
+
+static size_t csi_walk(size_t (*tok)(const char*, size_t, int*), const struct corpus* c, int* sum) {
+	size_t i = 0, seqs = 0;
+	*sum = 0;
+	while (i + 1 < c->len) {
+		const char* esc = memchr(c->data + i, 0x1B, c->len - i - 1);
+		if (esc == NULL) break;
+		i = esc - c->data;
+		if (c->data[i + 1] == '[') {
+			size_t l = tok(c->data + i + 2, c->len - i - 2, sum);
+			if (l == 0) break;
+			i += l + 2;
+			seqs++;
+		}
+		else i++;
+	}
+	return seqs;
+}
+
+struct csi_count {
+	size_t seqs;
+	int sum;
+};
+
+static int csi_count(void* opaque, const struct vt_csi* seq) {
+	struct csi_count* cc = opaque;
+	cc->seqs++;
+	for (int i = 0; i < seq->n; i++) cc->sum += vt_csi_param(seq, i, 0);
+	return 1;
+}
+
+// The whole table driven parser, text and all, with nothing attached but the CSI counter
+static size_t csi_parser(const struct corpus* c, int* sum) {
+	static const struct vt_parser_cb cb = { .csi = csi_count };
+	struct csi_count cc = { 0, 0 };
+	struct vt_parser ps;
+	vt_parser_init(&ps, &cb, &cc);
+	vt_parser_feed(&ps, c->data, c->len);
+	*sum = cc.sum;
+	return cc.seqs;
+}
+
+static size_t csi_twopass_walk(const struct corpus* c, int* sum) {
+	return csi_walk(csi_twopass, c, sum);
+}
+
+static void bench_csi(const struct corpus* c) {
+	static const struct {
+		const char* name;
+		size_t (*run)(const struct corpus*, int*);
+	} runs[] = {
+		{ "two-pass", csi_twopass_walk },
+		{ "parser", csi_parser },
+	};
+
+	for (size_t k = 0; k < sizeof(runs) / sizeof(*runs); k++) {
+		size_t iters = 0, seqs = 0;
+		int sum;
+		double t0 = now(), t;
+		do {
+			seqs = runs[k].run(c, &sum);
+			iters++;
+		} while ((t = now() - t0) < 0.25);
+		printf("  csi  %-8s %9.1f MB/s  %6.2f ns/seq   %zu seqs, param sum %d\n", runs[k].name,
+			c->len * iters / t / 1e6, seqs ? t * 1e9 / (seqs * iters) : 0, seqs, sum);	// No CSIs, no time per one
+	}
+}
+
+// -------------------- SCROLLING
+// yes(1) style output, every line feed scrolls. Row rotation in the grid vs moving the cells
+// of the whole region like a naive screen model would.
+
+struct scroll_run {
+	struct vt_grid g;
+	int naive;
+	size_t lines;
+};
+
+static int scroll_print(void* opaque, const char* s, size_t len) {
+	struct scroll_run* r = opaque;
+	vt_grid_print(&r->g, s, len, 0, 0);
+	return 1;
+}
+
+static void scroll_naive(struct vt_grid* g) {
+	size_t top = vt_grid_at(g, g->top), next = vt_grid_at(g, g->top + 1);
+	size_t n = (size_t) (g->bot - g->top) * g->cols, last = vt_grid_at(g, g->bot);
+	memmove(g->glyph + top, g->glyph + next, n * sizeof(uint32_t));
+	memmove(g->chan + top, g->chan + next, n * sizeof(uint64_t));
+	memmove(g->attr + top, g->attr + next, n * sizeof(uint16_t));
+	memset(g->glyph + last, 0, g->cols * sizeof(uint32_t));
+	memset(g->chan + last, 0, g->cols * sizeof(uint64_t));
+	memset(g->attr + last, 0, g->cols * sizeof(uint16_t));
+	vt_grid_touch_all(g);
+}
+
+static int scroll_execute(void* opaque, unsigned char c) {
+	struct scroll_run* r = opaque;
+	if (c != '\n') return 1;
+	r->lines++;
+	if (r->naive && r->g.y == r->g.bot) {
+		r->g.x = 0;
+		scroll_naive(&r->g);
+	}
+	else vt_grid_newline(&r->g);
+	return 1;
+}
+
+static void bench_scroll(void) {
+	static const struct vt_parser_cb cb = { .print = scroll_print, .execute = scroll_execute };
+	static const struct {
+		const char* name;
+		int top, bot, naive;
+	} runs[] = {
+		{ "rotate, 30 row region", 5, 34, 0 },
+		{ "naive, 30 row region", 5, 34, 1 },
+		{ "rotate, full screen", 0, 39, 0 },
+	};
+	struct corpus c;
+	struct scroll_run r;
+	struct vt_parser ps;
+
+	c.len = 1 << 20;
+	c.data = malloc(c.len);
+	for (size_t i = 0; i < c.len; i += 2) memcpy(c.data + i, "y\n", 2);
+
+	printf("yes | 40x120 grid\n");
+	for (size_t k = 0; k < sizeof(runs) / sizeof(*runs); k++) {
+		vt_grid_init(&r.g, 40, 120, NULL);
+		vt_grid_margins(&r.g, runs[k].top, runs[k].bot);
+		r.naive = runs[k].naive;
+		r.lines = 0;
+		vt_parser_init(&ps, &cb, &r);
+		double t0 = now(), t;
+		do vt_parser_feed(&ps, c.data, c.len);
+		while ((t = now() - t0) < 0.25);
+		printf("  scroll %-22s %8.2f M lines/s\n", runs[k].name, r.lines / t / 1e6);
+		vt_grid_fini(&r.g);
+	}
+	free(c.data);
+}
+
+// -------------------- PUTVT
+// Everything between the bytes and the plane: parsing, the grid, scrollback, blitting to a plane
+// in a pile of its own, which is never rendered.
+// Allocations are counted by wrapping malloc (glibc's __libc_* entry points do the work), notcurses' own
+// included. Plane calls are the notcurses functions the blit ends up in, wrapped with ld --wrap (see bench).
+
+static size_t allocs;
+static size_t plane_calls;
+
+extern void* __libc_malloc(size_t n);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* p, size_t n);
+
+void* malloc(size_t n) {
+	allocs++;
+	return __libc_malloc(n);
+}
+
+void* calloc(size_t n, size_t size) {
+	allocs++;
+	return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t n) {
+	allocs++;
+	return __libc_realloc(p, n);
+}
+
+int __real_ncplane_putegc_yx(struct ncplane* n, int y, int x, const char* gclust, size_t* sbytes);
+void __real_ncplane_set_channels(struct ncplane* n, uint64_t channels);
+void __real_ncplane_set_styles(struct ncplane* n, unsigned stylebits);
+int __real_ncplane_cursor_move_yx(struct ncplane* n, int y, int x);
+
+int __wrap_ncplane_putegc_yx(struct ncplane* n, int y, int x, const char* gclust, size_t* sbytes) {
+	plane_calls++;
+	return __real_ncplane_putegc_yx(n, y, x, gclust, sbytes);
+}
+
+void __wrap_ncplane_set_channels(struct ncplane* n, uint64_t channels) {
+	plane_calls++;
+	__real_ncplane_set_channels(n, channels);
+}
+
+void __wrap_ncplane_set_styles(struct ncplane* n, unsigned stylebits) {
+	plane_calls++;
+	__real_ncplane_set_styles(n, stylebits);
+}
+
+int __wrap_ncplane_cursor_move_yx(struct ncplane* n, int y, int x) {
+	plane_calls++;
+	return __real_ncplane_cursor_move_yx(n, y, x);
+}
+
+static void putvt_pass(struct ncplane* n, struct ncvtctx* ctx, const struct corpus* c, size_t chunk) {
+	for (size_t i = 0; i < c->len; i += chunk)
+		ncplane_putvt(n, ctx, c->data + i, c->len - i < chunk ? c->len - i : chunk);
+}
+
+// One warm-up pass on a fresh context, so the grid and the first scrollback blocks are there, then timed ones
+static void bench_putvt(struct notcurses* nc, const struct corpus* c, size_t chunk) {
+	struct ncplane_options opts = { .rows = 40, .cols = 120 };
+	struct ncplane* n = ncpile_create(nc, &opts);
+	struct ncvtctx ctx;
+
+	vtctx_init(&ctx);
+	putvt_pass(n, &ctx, c, chunk);
+	allocs = plane_calls = 0;
+	size_t iters = 0;
+	double t0 = now(), t;
+	do {
+		putvt_pass(n, &ctx, c, chunk);
+		iters++;
+	} while ((t = now() - t0) < 0.25);
+	double kb = c->len * iters / 1024.0;
+	printf("  putvt %-34s %7.1f MB/s  %6.2f ns/byte  %8.2f allocs/KB  %8.1f plane calls/KB\n",
+		c->name, c->len * iters / t / 1e6, t * 1e9 / (c->len * iters), allocs / kb, plane_calls / kb);
+	vtctx_fini(&ctx);
+	ncplane_destroy(n);
+}
+
+// Short lived terminals, like a CI dashboard opening and closing job logs: each one gets 256 KB of log,
+// most of it scrolled into the scrollback, then goes away. The heap must come out as it went in.
+static void bench_lifecycle(struct notcurses* nc) {
+	struct ncplane_options opts = { .rows = 40, .cols = 120 };
+	struct ncplane* n = ncpile_create(nc, &opts);
+	struct ncvtctx ctx;
+	struct corpus c;
+	const int terms = 200;
+	double fini = 0, t0 = now();
+	size_t mapped = 0;
+
+	corpus_ascii_log(&c, 256 << 10);
+	size_t heap = mallinfo2().uordblks;
+	for (int i = 0; i < terms; i++) {
+		vtctx_init(&ctx);
+		putvt_pass(n, &ctx, &c, 4096);
+		mapped += ctx.arena.mapped;
+		double t = now();
+		vtctx_fini(&ctx);
+		fini += now() - t;
+	}
+	double t = now() - t0;
+	long grew = (long) mallinfo2().uordblks - (long) heap;
+	printf("  %d terminals  %8.1f us each  %6.2f us in vtctx_fini  %5.1f MB arena each  heap %+ld bytes\n",
+		terms, t * 1e6 / terms, fini * 1e6 / terms, mapped / 1048576.0 / terms, grew);
+	free(c.data);
+	ncplane_destroy(n);
+}
+
+static void bench_putvt_all(const char** paths, int npaths) {
+	struct notcurses_options opts = {
+		.flags = NCOPTION_SUPPRESS_BANNERS | NCOPTION_NO_ALTERNATE_SCREEN | NCOPTION_INHIBIT_SETLOCALE |
+			NCOPTION_NO_QUIT_SIGHANDLERS | NCOPTION_NO_WINCH_SIGHANDLER,
+	};
+	FILE* out = fopen("/dev/null", "w");
+	struct notcurses* nc = notcurses_core_init(&opts, out);
+	struct corpus c;
+	char name[64];
+
+	if (nc == NULL) {
+		fprintf(stderr, "Failed to start notcurses, skipping putvt\n");
+		return;
+	}
+	printf("putvt | 40x120 plane, 4096 byte chunks\n");
+	for (int i = 0; i < npaths; i++) {
+		if (corpus_load(&c, paths[i])) continue;
+		bench_putvt(nc, &c, 4096);
+		if (i == 0) {	// Pathological: a call per byte, so every sequence is split
+			snprintf(name, sizeof(name), "%s, 1 byte chunks", paths[i]);
+			c.name = name;
+			bench_putvt(nc, &c, 1);
+		}
+		free(c.data);
+	}
+	corpus_ascii_log(&c, 1 << 20);
+	bench_putvt(nc, &c, 4096);
+	free(c.data);
+	corpus_vim(&c, 1 << 20);
+	bench_putvt(nc, &c, 4096);
+	free(c.data);
+	corpus_braille(&c, 1 << 20);
+	bench_putvt(nc, &c, 4096);
+	free(c.data);
+	corpus_cjk(&c, 1 << 20);
+	bench_putvt(nc, &c, 4096);
+	free(c.data);
+	corpus_emoji(&c, 1 << 20);
+	bench_putvt(nc, &c, 4096);
+	free(c.data);
+
+	printf("lifecycle | 40x120 plane, 256 KB of log each\n");
+	bench_lifecycle(nc);
+
+	notcurses_stop(nc);
+	fclose(out);
+}
+
+int main(int argc, char** argv) {
+	static const char* defaults[] = { "24bit.pattern", "8bit.pattern" };
+	const char** paths = argc > 1 ? (const char**) argv + 1 : defaults;
+	int n = argc > 1 ? argc - 1 : 2;
+	struct corpus c;
+
+	for (int i = 0; i < n; i++) {
+		if (corpus_load(&c, paths[i])) {
+			fprintf(stderr, "Failed to load %s\n", paths[i]);
+			return 1;
+		}
+		bench_scan(&c);
+		bench_csi(&c);
+		free(c.data);
+	}
+
+	corpus_ascii_log(&c, 1 << 20);
+	bench_scan(&c);
+	free(c.data);
+
+	corpus_cjk(&c, 1 << 20);
+	printf("%s (%zu bytes)\n", c.name, c.len);
+	bench_utf8(&c);
+	free(c.data);
+
+	setlocale(LC_ALL, "");
+	bench_scroll();
+	bench_putvt_all(paths, n);
+
+	return 0;
+}
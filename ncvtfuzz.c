@@ -0,0 +1,262 @@
+#include "ncvtproto.h"
+#include <locale.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Chunk boundary fuzzer. The same input is parsed in one go, a byte at a time, and split at random places,
+// and the grids and planes must come out exactly the same. Sequences, UTF-8 and OSC strings cut anywhere
+// must not make a difference - a single byte of it showing up on the screen aborts.
+//
+// Built with -DNCVT_LIBFUZZER it's a libFuzzer target (see fuzz), otherwise it runs over the files
+// given, or the .pattern files, with many different splits each.
+
+#define FUZZ_ROWS 10		// Small, so that everything scrolls a lot
+#define FUZZ_COLS 40
+
+static struct notcurses* nc;
+
+struct fuzz_term {
+	struct ncplane* n;
+	struct ncvtctx ctx;
+};
+
+static uint32_t fuzz_rnd(uint32_t* s) {
+	*s ^= *s << 13;
+	*s ^= *s >> 17;
+	*s ^= *s << 5;
+	return *s;
+}
+
+static void fuzz_start(void) {
+	struct notcurses_options opts = {
+		.flags = NCOPTION_SUPPRESS_BANNERS | NCOPTION_NO_ALTERNATE_SCREEN | NCOPTION_INHIBIT_SETLOCALE |
+			NCOPTION_NO_QUIT_SIGHANDLERS | NCOPTION_NO_WINCH_SIGHANDLER,
+	};
+	setlocale(LC_ALL, "C.UTF-8");
+	nc = notcurses_core_init(&opts, fopen("/dev/null", "w"));
+	if (nc == NULL) {
+		fprintf(stderr, "Failed to start notcurses\n");
+		exit(1);
+	}
+}
+
+// Feeds data in pieces of at most maxchunk bytes (0 - all at once), random sizes if seed isn't 0.
+// Every piece is blitted, like the demo does after each read.
+static void fuzz_feed(struct fuzz_term* t, const char* data, size_t len, size_t maxchunk, uint32_t seed) {
+	struct ncplane_options opts = { .rows = FUZZ_ROWS, .cols = FUZZ_COLS };
+	size_t i = 0, n;
+
+	t->n = ncpile_create(nc, &opts);
+	vtctx_init(&t->ctx);
+	ncplane_putvt(t->n, &t->ctx, "", 0);
+	while (i < len) {
+		n = len - i;
+		if (maxchunk && n > maxchunk) n = maxchunk;
+		if (seed) n = 1 + fuzz_rnd(&seed) % n;
+		ncplane_putvt(t->n, &t->ctx, data + i, n);
+		i += n;
+	}
+}
+
+static void fuzz_free(struct fuzz_term* t) {
+	vtctx_fini(&t->ctx);
+	ncplane_destroy(t->n);
+}
+
+// Clusters are compared by their text, not by their ids in the pools
+static int fuzz_same_glyph(const struct vt_grid* a, size_t i, const struct vt_grid* b, size_t j) {
+	const char *sa, *sb;
+	size_t la, lb;
+
+	if (!vt_glyph_pooled(a->glyph[i]) || !vt_glyph_pooled(b->glyph[j])) return a->glyph[i] == b->glyph[j];
+	sa = vt_glyphs_get(&a->pool, a->glyph[i], &la);
+	sb = vt_glyphs_get(&b->pool, b->glyph[j], &lb);
+	return la == lb && !memcmp(sa, sb, la);
+}
+
+static int fuzz_cmp_grid(const struct vt_grid* a, const struct vt_grid* b) {
+	if (a->y != b->y || a->x != b->x) {
+		fprintf(stderr, "cursor %d,%d vs %d,%d\n", a->y, a->x, b->y, b->x);
+		return -1;
+	}
+	if (a->top != b->top || a->bot != b->bot) {
+		fprintf(stderr, "margins %d-%d vs %d-%d\n", a->top, a->bot, b->top, b->bot);
+		return -1;
+	}
+	for (int y = 0; y < a->rows; y++) {
+		for (int x = 0; x < a->cols; x++) {
+			size_t i = vt_grid_at(a, y) + x, j = vt_grid_at(b, y) + x;
+			if (!fuzz_same_glyph(a, i, b, j) || a->chan[i] != b->chan[j] || a->attr[i] != b->attr[j]) {
+				fprintf(stderr, "grid cell %d,%d: %08x/%016llx/%04x vs %08x/%016llx/%04x\n", y, x,
+					a->glyph[i], (unsigned long long) a->chan[i], a->attr[i],
+					b->glyph[j], (unsigned long long) b->chan[j], b->attr[j]);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+static int fuzz_cmp_plane(struct ncplane* a, struct ncplane* b) {
+	uint16_t sta, stb;
+	uint64_t cha, chb;
+	unsigned ya, xa, yb, xb;
+	int r = 0;
+
+	for (int y = 0; y < FUZZ_ROWS && r == 0; y++) {
+		for (int x = 0; x < FUZZ_COLS && r == 0; x++) {
+			char* ea = ncplane_at_yx(a, y, x, &sta, &cha);
+			char* eb = ncplane_at_yx(b, y, x, &stb, &chb);
+			if (!ea || !eb || strcmp(ea, eb) || sta != stb || cha != chb) {
+				fprintf(stderr, "plane cell %d,%d: '%s' vs '%s'\n", y, x, ea ? ea : "?", eb ? eb : "?");
+				r = -1;
+			}
+			free(ea);
+			free(eb);
+		}
+	}
+	ncplane_cursor_yx(a, &ya, &xa);
+	ncplane_cursor_yx(b, &yb, &xb);
+	if (r == 0 && (ya != yb || xa != xb)) {
+		fprintf(stderr, "plane cursor %u,%u vs %u,%u\n", ya, xa, yb, xb);
+		r = -1;
+	}
+	return r;
+}
+
+// Everything the parser leaves behind besides the screens
+static int fuzz_cmp_ctx(const struct ncvtctx* a, const struct ncvtctx* b) {
+	if ((a->grid == &a->alt) != (b->grid == &b->alt)) {
+		fprintf(stderr, "different screens\n");
+		return -1;
+	}
+	if (a->channels != b->channels || a->curmem_x != b->curmem_x || a->curmem_y != b->curmem_y ||
+	    a->parser.state != b->parser.state || strcmp(a->title, b->title) || strcmp(a->link, b->link) ||
+	    a->sb.lines != b->sb.lines) {
+		fprintf(stderr, "context state differs\n");
+		return -1;
+	}
+	if (fuzz_cmp_grid(&a->screen, &b->screen) < 0) return -1;
+	return fuzz_cmp_grid(&a->alt, &b->alt);
+}
+
+// Returns 0 if data comes out the same however it's split, -1 otherwise
+static int fuzz_one(const char* data, size_t len, uint32_t seed) {
+	static const struct {
+		const char* name;
+		size_t maxchunk;
+		int random;
+	} splits[] = {
+		{ "byte by byte", 1, 0 },
+		{ "random, up to 16", 16, 1 },
+		{ "random", 0, 1 },
+	};
+	struct fuzz_term ref, t;
+	int r = 0;
+
+	fuzz_feed(&ref, data, len, 0, 0);
+	for (size_t k = 0; k < sizeof(splits) / sizeof(*splits) && r == 0; k++) {
+		fuzz_feed(&t, data, len, splits[k].maxchunk, splits[k].random ? seed : 0);
+		if (fuzz_cmp_ctx(&ref.ctx, &t.ctx) < 0 || fuzz_cmp_plane(ref.n, t.n) < 0) {
+			fprintf(stderr, "%zu bytes split %s (seed %u) differ from one go\n", len, splits[k].name, seed);
+			r = -1;
+		}
+		fuzz_free(&t);
+	}
+	fuzz_free(&ref);
+	return r;
+}
+
+// Every cell a different cluster of a letter and 15 combining marks, 31 bytes each, so that what is on
+// the screen takes nearly all of the pool's arena and interning fails even after a sweep. The joins that
+// fail must leave the cells alone: every id on the screen has to stay in the pool.
+#define POOL_ROWS 30
+#define POOL_COLS 80
+
+static int fuzz_pool_full(void) {
+	struct ncplane_options opts = { .rows = POOL_ROWS, .cols = POOL_COLS };
+	struct fuzz_term t;
+	char cl[32];
+	int r = 0;
+
+	t.n = ncpile_create(nc, &opts);
+	vtctx_init(&t.ctx);
+	ncplane_putvt(t.n, &t.ctx, "", 0);
+	for (uint32_t k = 0; k < 2 * POOL_ROWS * POOL_COLS && r == 0; k++) {
+		size_t len = 0;
+		cl[len++] = 'a' + k % 26;
+		for (int m = 0; m < 15; m++) {	// The first two marks number the cell, the rest pad it out
+			uint32_t cp = 0x300 + (m == 0 ? k % 112 : m == 1 ? k / 112 % 112 : m);
+			cl[len++] = 0xC0 | cp >> 6;
+			cl[len++] = 0x80 | (cp & 0x3F);
+		}
+		if (vtctx_feed(&t.ctx, cl, len) < 0) r = -1;
+		const struct vt_grid* g = t.ctx.grid;
+		uint32_t glyph = g->glyph[vt_grid_at(g, g->y) + g->x - 1];
+		const char* s = cl;
+		size_t l = 1;
+		if (vt_glyph_pooled(glyph) && (glyph & ~VT_GLYPH_POOLED) < g->pool.n) s = vt_glyphs_get(&g->pool, glyph, &l);
+		else if (glyph != (unsigned char) cl[0]) l = 0;
+		if (l == 0 || l > len || memcmp(s, cl, l)) {	// Whatever marks didn't fit are lost, the rest must be there
+			fprintf(stderr, "cluster %u came out wrong\n", k);
+			r = -1;
+		}
+		for (size_t i = 0; i < (size_t) g->rows * g->cols && r == 0; i++) {
+			if (vt_glyph_pooled(g->glyph[i]) && (g->glyph[i] & ~VT_GLYPH_POOLED) >= g->pool.n) {
+				fprintf(stderr, "cell %zu refers to cluster %u of %u\n", i, g->glyph[i] & ~VT_GLYPH_POOLED, g->pool.n);
+				r = -1;
+			}
+		}
+		if (r == 0 && vtctx_blit(&t.ctx) < 0) r = -1;
+	}
+	fuzz_free(&t);
+	return r;
+}
+
+#ifdef NCVT_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	uint32_t seed = 2166136261u;
+
+	if (nc == NULL) fuzz_start();
+	for (size_t i = 0; i < size; i++) seed = (seed ^ data[i]) * 16777619u;	// Same input, same splits
+	if (fuzz_one((const char*) data, size, seed | 1) < 0) abort();
+	return 0;
+}
+
+#else
+
+int main(int argc, char** argv) {
+	static const char* defaults[] = { "24bit.pattern", "8bit.pattern" };
+	const char** paths = argc > 1 ? (const char**) argv + 1 : defaults;
+	int n = argc > 1 ? argc - 1 : 2;
+	int fails = 0;
+
+	fuzz_start();
+	fails += fuzz_pool_full() < 0;
+	printf("full cluster pool: %s\n", fails ? "FAILED" : "ok");
+	for (int i = 0; i < n; i++) {
+		FILE* fp = fopen(paths[i], "rb");
+		if (fp == NULL) {
+			fprintf(stderr, "Failed to load %s\n", paths[i]);
+			return 1;
+		}
+		fseek(fp, 0, SEEK_END);
+		size_t len = ftell(fp);
+		rewind(fp);
+		char* data = malloc(len);
+		if (fread(data, 1, len, fp) != len) len = 0;
+		fclose(fp);
+
+		int bad = 0;
+		for (uint32_t seed = 1; seed <= 64 && !bad; seed++) bad = fuzz_one(data, len, seed) < 0;
+		printf("%s: %s\n", paths[i], bad ? "FAILED" : "ok");
+		fails += bad;
+		free(data);
+	}
+	notcurses_stop(nc);
+	return fails != 0;
+}
+
+#endif
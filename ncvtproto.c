@@ -1,6 +1,8 @@
 #define LIBSSH_STATIC 1
 #include "libssh/libssh.h"
-#include "notcurses/notcurses.h"
+#include "ncvtproto.h"
+#include "vt_colors.h"
+#include "vt_width.h"
 #include <locale.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -9,20 +11,23 @@
 // STUFF SUPPORTED SO FAR:
 // UTF-8
 // 3/4/8/24 bit colors
-//
-// TODO:
-//
-// \e[m			// SGR (TODO: Default argument)
-// \e[2J		// Erase in display (args 0-3) 
-// \e[J			// Erase in display 0
-// \e[2d		// Line Position Absolute (Default 1)
-// \e[30X		// Erase 30 characters (Default 1)
+// \e[1;27r		// Set scrolling region (from, to) (default top, bottom)
+// \e[S \e[T		// Scroll up / down (default 1)
+// \e[2J		// Erase in display (args 0-3), with the current background
 // \e[K			// Erase in line, args 0-2 (default 0)
+// \e[30X		// Erase 30 characters (Default 1)
+// \e[2d		// Line Position Absolute (Default 1)
 // \e[y;xH		// Move cursor to y,x
-// \e]0; ... \007 	// ESC ] = OSC, terminated with BEL (0x07) or ST (0x1b \), or nothing
 // \e[?1049h		// Alternative screen buffer
 // \e[?1049l		// Disable alternative screen buffer
-// \e[1;27r		// Set scrolling region (from, to) (default top, bottom)
+// \e]0; ... \007 	// ESC ] = OSC, terminated with BEL (0x07) or ST (0x1b \), or CAN/SUB to cancel
+// \e]2; ... \007 	// Window title (0 sets the icon name too, which is the same thing here)
+// \e]8;;URI\007	// Hyperlink start, \e]8;;\007 ends it
+// \e]52;c;BASE64\007	// Copy to clipboard, through vtctx->clipboard
+//
+// TODO:
+//
+// \e[m			// SGR (TODO: Default argument)
 // \e[4h		// Set Mode (12 = Send/Receive; 20 = automatic newline; 4 = insert mode; +1)
 // \e[4l		// Reset Mode (2 = Keyboard Action Mode, 4 = Replace mode; +2)
 // \e[?7h		// Auto wrap mode (DECAWM)
@@ -31,9 +36,6 @@
 // \e[?1000h		// Send Mouse X & Y on button press and release. This is the X11 xterm mouse protocol.
 // \e[?1000l		// Don't send...
 //
-// Essential:
-// \e[m \e[2j \e[J \e[2d \e[30X \e[K \e[H
-//
 // WTF SEQUENCES:
 // \e=			// Application Keypad (DECKPAM)
 // \e[?1h		// Application cursor keys (DECCKM)
@@ -45,362 +47,559 @@
 // \e[?12l		// Start/Stop blinking cursor
 
 
- 
-struct ncvtctx {	// VT context
-	int curmem_x;
-	int curmem_y;
-	char* cbuf;	// Carry buffer (stuff that wasn't processed last time, plus stuff currently to be processed)
-	size_t cbs;	// Carry buffer size
-	size_t cs;	// Carry size (length of stuff stored in buffer)
-};
-
-struct ncvtsms {	// VT state machine state
-	struct ncplane* n;
-	struct ncvtctx* vtctx;
-	ssize_t pos;	// current position
-	ssize_t lop;	// position where the last output has been produced
-};
-
-static inline size_t	// TODO: This should be in the library, dunno why I cannot call it. :/
-utf8_codepoint_length(unsigned char c){
-  if(c <= 0x7f){        // 0x000000...0x00007f
-    return 1;
-  }else if(c <= 0xc1){  // illegal continuation byte
-    return 1;
-  }else if(c <= 0xdf){  // 0x000080...0x0007ff
-    return 2;
-  }else if(c <= 0xef){  // 0x000800...0x00ffff
-    return 3;
-  }else if(c <= 0xf4){  // c <= 0xf4, 0x100000...0x10ffff
-    return 4;
-  }else{                // illegal first byte
-    return 1;
-  }
-}
-
-int vt_8bpal(struct ncvtsms* s, int p, bool fg) {
-	int r, g, b;
-
-	// The following 3/4 bit codes shall not be translated to RGB - that's a temporary solution
-	if (p < 8) {
-		r = ( p    % 2 ? 170 : 0);
-		g = ((p/2) % 2 ? 170 : 0);
-		b = ((p/4) % 2 ? 170 : 0);
-	}
-	else if (p >= 8 && p < 16) {
-		r = ( p    % 2 ? 255 : 85);
-		g = ((p/2) % 2 ? 255 : 85);
-		b = ((p/4) % 2 ? 255 : 85);
-	}
-	
-	// The following 8-bit codes probably should be handled by something else (ncplane_set_.g_palindex())
-
-	else if (p >= 16 && p < 232) {
-		p -= 16;
-		b = (p % 6) * 51;
-		p /= 6;
-		g = (p % 6) * 51;
-		p /= 6;
-		r = (p % 6) * 51;
-	}
-
-	else {
-		p -= 231;
-		r = p * 8;
-		g = r;
-		b = r;
-	}
-
-	if (fg) ncplane_set_fg_rgb8(s->n, r, g, b);
-	else    ncplane_set_bg_rgb8(s->n, r, g, b);
-	
-	return 1; // TODO react to actual ncplane call returns
+static const struct vt_parser_cb vt_callbacks;
 
+// Sets up a fresh VT context. The grid is allocated once a plane comes along, vtctx_fini frees it.
+void vtctx_init(struct ncvtctx* vtctx) {
+	memset(vtctx, 0, sizeof(*vtctx));
+	vt_arena_init(&vtctx->arena, VT_CTX_ARENA, false);	// Nothing is mapped until the first output
+	vtctx->palette = vt_palette(VT_PAL_VGA);
+	vt_parser_init(&vtctx->parser, &vt_callbacks, vtctx);
+	vt_sb_init(&vtctx->sb, VT_SB_DEFAULT);	// vt_sb_init again before the first output to change the depth
+	vtctx->unknown_policy = VT_UNKNOWN_COUNT;
+	vtctx->pty.fd = -1;
+	vtctx->pty.epfd = -1;
 }
 
-
-
-
-// Checks if current byte is outside the buffer bounds
-static inline bool vt_eob(struct ncvtsms* sms) {
-	return (sms->pos >= sms->vtctx->cs);
-}
-
-// Checks how many bytes are availabe in the buffer past pos
-static inline size_t vt_ppos(struct ncvtsms* sms) {
-	return (sms->vtctx->cs - sms->pos - 1);
+static void vt_worker_join(struct ncvtctx* vtctx);
+
+// Grids, clusters and scrollback all live in the arena, nothing has to be freed on its own.
+// Only a worker still running has a thread, a lock and a ring to take down first. The plane may be gone, no blit.
+void vtctx_fini(struct ncvtctx* vtctx) {
+	if (vtctx->threaded) vt_worker_join(vtctx);
+	vt_arena_fini(&vtctx->arena);
+	memset(&vtctx->screen, 0, sizeof(vtctx->screen));
+	memset(&vtctx->alt, 0, sizeof(vtctx->alt));
+	vtctx->grid = NULL;
+	vt_sb_init(&vtctx->sb, vtctx->sb.maxlines);
 }
 
-// byte fetch, from cbuf
-static const inline char* vt_bfetch_p(const struct ncvtsms* s, size_t pos) {
-	return (s->vtctx->cbuf + pos);
+// Binds the context to plane n. Both grids follow the plane's size, the screen starts off with what's on it.
+static int vtctx_attach(struct ncvtctx* vtctx, struct ncplane* n) {
+	unsigned urows, ucols;
+
+	ncplane_dim_yx(n, &urows, &ucols);
+	int rows = urows, cols = ucols;
+	vtctx->n = n;
+	if (vtctx->grid == NULL) {
+		if (vt_grid_init(&vtctx->screen, rows, cols, &vtctx->arena) < 0) return -1;
+		if (vt_grid_init(&vtctx->alt, rows, cols, &vtctx->arena) < 0) {
+			vt_grid_fini(&vtctx->screen);
+			return -1;
+		}
+		vtctx->sb.mem = &vtctx->arena;	// Not before, vt_sb_init may be called again until now
+		vtctx->screen.sb = &vtctx->sb;
+		vt_grid_load(&vtctx->screen, n);
+		vtctx->grid = &vtctx->screen;
+		return 0;
+	}
+	if (rows != vtctx->grid->rows || cols != vtctx->grid->cols) {
+		if (vt_grid_resize(&vtctx->screen, rows, cols) < 0) return -1;
+		if (vt_grid_resize(&vtctx->alt, rows, cols) < 0) return -1;
+		if (vtctx->pty.fd >= 0) vt_pty_resize(&vtctx->pty, rows, cols);	// The child redraws on SIGWINCH
+	}
+	return 0;
 }
 
-// Same but always fetches the byte from current position
-static const inline char* vt_bfetch(const struct ncvtsms* s) {
-	return vt_bfetch_p(s, s->pos);
+// ------------------- PARSER CALLBACKS
+// The parser (vt_parser.c) finds sequences, these functions make them happen on the grid.
+// All of them return an integer code:
+//  1 - OK, the parser may continue
+// negative value - major oopsie, the parser stops and ncplane_putvt returns it
+
+// Printable text, written to the grid in one go with the colors SGRs left in vt->channels
+static int vt_print(void* opaque, const char* s, size_t len) {
+	struct ncvtctx* vt = opaque;
+	vt_grid_print(vt->grid, s, len, vt->channels, 0);
+	return 1;
 }
 
-// ------------------- A FEW GENERAL STATES
-// All states return an integer code that acts as a feedback to the main loop / base state:
-//  1 - Parsed OK, the main loop may continue
-//  0 - Did not parse because the buffer has ended prematurely (returned by vt_end only)
-// negative value - major oopsie (should be returned by vt_error only)
-// Thus each state shall return whatever has been returned by the states called by them.
+// C0 controls
+static int vt_execute(void* opaque, unsigned char c) {
+	struct ncvtctx* vt = opaque;
+	struct vt_grid* g = vt->grid;
 
-// Writes bytes directly to ncplane, from lop+1 to pos
-static int vt_pass(struct ncvtsms* s) {
-	// TODO: Do it better
-	while (s->lop < s->pos) {
-		s->lop++;
-		ncplane_putchar(s->n, *vt_bfetch_p(s, s->lop));
+	switch (c) {
+		case '\n':	// LF, VT and FF are all the same, down a row keeping the column. The tty adds the CR (onlcr).
+		case 0x0B:
+		case 0x0C:
+			vt_grid_index(g);
+			return 1;
+		case '\r':
+			g->x = 0;
+			return 1;
+		case '\b':
+			if (g->x >= g->cols) g->x = g->cols - 1;
+			if (g->x > 0) g->x--;
+			return 1;
+		case '\t':	// Fixed tab stops every 8 columns
+			g->x = (g->x / 8 + 1) * 8;
+			if (g->x >= g->cols) g->x = g->cols - 1;
+			return 1;
+		case 0x18:	// CAN and SUB cancel an OSC, its end comes right after
+		case 0x1A:
+			vt->osc.drop = true;
+			return 1;
+		default:	// BEL and the rest are ignored
+			return 1;
 	}
-	return 1;	// TODO: check if ncplane_putwhatever has succeeded	
-}
-
-// Handles unknown state - when parser got unexpected data
-static int vt_unknown(struct ncvtsms* s) {
-	return vt_pass(s);	// For now we treat invalid codes as normal text
-}
-
-// Handles error state - returns error code of putvt 
-static int vt_error(struct ncvtsms* s) {
-	return -(s->lop);
 }
 
-// Handles end of buffer during parsing
-static int vt_end(struct ncvtsms* s) {
-	if (s->lop < s->pos) {
-		memmove(s->vtctx->cbuf, s->vtctx->cbuf + s->lop + 1, s->vtctx->cs - s->lop - 1);
-		s->vtctx->cs = s->vtctx->cs - s->lop - 1;
-	}
-	else {
-		s->vtctx->cs = 0;
+// Sequences nothing here handles. The parser has consumed them already, possibly across several buffers,
+// so they can't be passed through as they came - vt->unknown_policy says what to do instead.
+
+// ESC and CSI sequences put back together as text, ESC being U+241B. Returns the length.
+static size_t vt_seq_text(enum vt_seq_kind kind, const struct vt_csi* seq, char* o) {
+	char* p = o;
+
+	memcpy(p, "\xE2\x90\x9B", 3);
+	p += 3;
+	if (kind != VT_SEQ_ESC) {
+		*p++ = '[';
+		if (seq->priv) *p++ = seq->priv;
+		for (int i = 0; i < seq->n; i++) {
+			if (i) *p++ = vt_csi_issub(seq, i) ? ':' : ';';
+			if (seq->param[i] != VT_CSI_NONE) p += sprintf(p, "%u", seq->param[i]);
+		}
 	}
-	return 0;	// Oh jeez...
+	for (int i = 0; i < seq->ninter; i++) *p++ = seq->inter[i];
+	*p++ = seq->final;
+	return p - o;
 }
 
-// -------------------- ACTUAL PARSING STATES
-
-
-static int vt_get_csi_param(struct ncvtsms* s, int def) {
-	// parses an argument that starts at pos+1
-	// missing (default) argument is replaced with 'def'.
-	// if no more params are available, returns -2
-	// vt_eob: -3 (should never happen)
-	// Don't feed it inconsistent data, or you'll get inconsistent results.
-	
-	
-	if (strchr(";:?[", *vt_bfetch(s)) == NULL) return -2;
-	s->pos++; if (vt_eob(s)) return -3;
-
-	int output = -1;
-	while (*vt_bfetch(s) >= 48 && *vt_bfetch(s) < 58) {
-		if (output < 0) output = 0;
-		output *= 10;
-		output += *vt_bfetch(s) - 48;		// Is this kosher?
-		s->pos++; if (vt_eob(s)) return -3;
-	}
-	if (output == -1) return def;
-	else return output;
+// key is the final byte, or the intermediate for ESC sequences with one (character sets), or the OSC number.
+// seq may be NULL if there's nothing to show.
+static int vt_unknown(struct ncvtctx* vt, enum vt_seq_kind kind, unsigned key, const struct vt_csi* seq) {
+	char buf[8 + VT_CSI_MAXPARAM * 5 + VT_CSI_MAXINTER];
 
+	if (vt->unknown_policy == VT_UNKNOWN_SWALLOW) return 1;
+	vt->unknown[kind][key < 127 ? key : 127]++;
+	if (vt->unknown_policy == VT_UNKNOWN_SHOW && seq)	// All of it in one go
+		vt_grid_print(vt->grid, buf, vt_seq_text(kind, seq, buf), vt->channels, 0);
+	return 1;
 }
 
+// ESC sequences other than CSI, OSC, DCS - none supported yet (\e(B, \e=, \e> etc.)
+static int vt_esc(void* opaque, const struct vt_csi* seq) {
+	if (seq->final == '\\' && !seq->ninter) return 1;	// ST, the end of an OSC or DCS
+	return vt_unknown(opaque, VT_SEQ_ESC, seq->ninter ? seq->inter[0] : seq->final, seq);
+}
 
-static int vt_sgr(struct ncvtsms* s) {
+// SGR only changes vt->channels, the plane is updated by vt_print when needed
+static int vt_sgr(struct ncvtctx* vt, const struct vt_csi* csi) {
+	int i = 0;
 	int c;
-
-	int r, g, b;	// These are needed inside the loop, but one can't declare after the label. :/
 	bool fg;
 
- 	c = vt_get_csi_param(s, 0);
-	while (c > -2) {	
+	do {	// SGR without parameters is the same as 0
+		c = vt_csi_param(csi, i++, 0);
 		switch (c) {
 			case 0:				// Reset or normal
-				ncplane_set_fg_default(s->n);
-				ncplane_set_bg_default(s->n);
+				ncchannels_set_fg_default(&vt->channels);
+				ncchannels_set_bg_default(&vt->channels);
 				break;
 			// TODO support more!
 			case 38:			// Foreground color 	
 			case 48:			// Background color 
+				// Both "38;2;r;g;b" and "38:2:[colorspace]:r:g:b" forms are accepted
 				fg = (c == 38);
- 				c = vt_get_csi_param(s, 0);
-				switch (c) {
+				switch (vt_csi_param(csi, i++, 0)) {
 					case 5: 	// 8-bit palette
- 						c = vt_get_csi_param(s, 0);
-						vt_8bpal(s, c, fg);
+						vt_8bc(vt->palette, &vt->channels, vt_csi_param(csi, i++, 0), fg);
 						break;
 					case 2:		// 24-bit RGB color
- 						r = vt_get_csi_param(s, 0);
- 						g = vt_get_csi_param(s, 0);
- 						b = vt_get_csi_param(s, 0);
-						if (fg) ncplane_set_fg_rgb8(s->n, r, g, b);
-						else    ncplane_set_bg_rgb8(s->n, r, g, b);
+						if (vt_csi_issub(csi, i) && vt_csi_issub(csi, i + 3)) i++;
+						if (fg) ncchannels_set_fg_rgb8(&vt->channels, vt_csi_param(csi, i, 0),
+							vt_csi_param(csi, i + 1, 0), vt_csi_param(csi, i + 2, 0));
+						else    ncchannels_set_bg_rgb8(&vt->channels, vt_csi_param(csi, i, 0),
+							vt_csi_param(csi, i + 1, 0), vt_csi_param(csi, i + 2, 0));
+						i += 3;
 				}
 				break;
 
 			default:	// 3/4-bit colors
-				if (c >= 30 && c <=37) vt_8bpal(s, c - 30, 1);
-				if (c >= 90 && c <=97) vt_8bpal(s, c - 82, 1);
-				if (c >= 40 && c <=47) vt_8bpal(s, c - 40, 0);
-				if (c >= 100 && c <=107) vt_8bpal(s, c - 92, 0);
+				vt_4bc(vt->palette, &vt->channels, c);
 		}
- 		c = vt_get_csi_param(s, 0);
-	}
-	return 1;	// TODO actual return lol
-}
-// After detecting '\x1b\x5b'
-static int vt_csi(struct ncvtsms* s) {
-
-	// Parameter, intermediate and final bytes, as defined for CSI
-	// Intermediate bytes are disabled for now, not supported by any sequence ATM
-	// The following jumps over params just to get final byte - params are parsed later.
-	
-	ssize_t init_pos = s->pos;
-	char f;		// Final byte
-	char ft;	// First byte (i.e. '?' for private sequences)
-
-	s->pos++; if (vt_eob(s)) return vt_end(s);
-	ft = *vt_bfetch(s);
-	// Jump over param bytes
-	while (*vt_bfetch(s) >= 0x30 && *vt_bfetch(s) <=0x3F) {
-		s->pos++; if (vt_eob(s)) return vt_end(s);
+		while (vt_csi_issub(csi, i)) i++;	// Skip whatever sub-params weren't used
 	}
+	while (i < csi->n);
+	return 1;
+}
 
-	/*
-	while (*vt_bfetch(s) >= 0x20 && *vt_bfetch(s) <=0x2F) {
-		s->pos++; if (vt_eob(s)) return vt_end(s);
-	}
-	*/
-
-	f = *vt_bfetch(s);	// Get final byte
-	s->pos = init_pos;	// Rewind pos to initial state, so param parsers don't get confused
-	
-	// At this point we are sure the CSI is complete and we may carry on interpreting it
-	
-	if (ft == '?') {	// Private sequences
-		s->pos++;
-		switch (f) {
-			case 'h':
-				return 1; // TODO
+// Set scrolling region, the cursor goes home
+static int vt_decstbm(struct ncvtctx* vt, const struct vt_csi* csi) {
+	struct vt_grid* g = vt->grid;
+	int top = vt_csi_param(csi, 0, 0);
+	int bot = vt_csi_param(csi, 1, 0);
+
+	vt_grid_margins(g, top ? top - 1 : 0, bot ? bot - 1 : g->rows - 1);
+	g->y = 0;
+	g->x = 0;
+	return 1;
+}
+
+// Scroll up (S) or down (T) within the region, the cursor stays
+static int vt_scroll(struct ncvtctx* vt, const struct vt_csi* csi) {
+	int n = vt_csi_param(csi, 0, 1);
+	if (csi->final == 'S') vt_grid_scroll(vt->grid, n ? n : 1);
+	else vt_grid_scroll_down(vt->grid, n ? n : 1);
+	return 1;
+}
+
+// Erased cells take the current background, the foreground goes back to default (like xterm's BCE)
+static inline uint64_t vt_erase_chan(const struct ncvtctx* vt) {
+	return ncchannels_bchannel(vt->channels);
+}
+
+// ED: 0 - cursor to the end, 1 - start to the cursor, 2 - everything, 3 - scrollback only.
+// The cursor stays where it is.
+static int vt_ed(struct ncvtctx* vt, const struct vt_csi* csi) {
+	struct vt_grid* g = vt->grid;
+	uint64_t chan = vt_erase_chan(vt);
+	int x = g->x < g->cols ? g->x : g->cols - 1;
+
+	switch (vt_csi_param(csi, 0, 0)) {
+		case 0:
+			vt_grid_erase(g, g->y, x, g->cols, chan);
+			vt_grid_erase_rows(g, g->y + 1, g->rows, chan);
 			break;
-			case 'l':
-				return 1; // TODO
+		case 1:
+			vt_grid_erase_rows(g, 0, g->y, chan);
+			vt_grid_erase(g, g->y, 0, x + 1, chan);
+			break;
+		case 2:
+			vt_grid_erase_rows(g, 0, g->rows, chan);
+			break;
+		case 3:
+			vt_sb_fini(&vt->sb);
 			break;
-			default: return vt_unknown(s);
-		}
 	}
+	return 1;
+}
 
-	switch (f) {
-		// Erase functions
-		case 'J':	// Erase display
-			switch (vt_get_csi_param(s, 0)){
-				case 0:
-					// Erase without moving cursor?
-					return 1;
-				case 1:
-				// What does case 1 do?
-				case 2:
-				case 3:
-					// Erase and home cursor
-					return 1;
-				default: return vt_unknown(s);
-			}; 
-		case 'K':	// Erase line, do not move cursor. Check the args.
+// EL: 0 - cursor to the end of line, 1 - start of line to the cursor, 2 - whole line
+static int vt_el(struct ncvtctx* vt, const struct vt_csi* csi) {
+	struct vt_grid* g = vt->grid;
+	uint64_t chan = vt_erase_chan(vt);
+	int x = g->x < g->cols ? g->x : g->cols - 1;
 
-			return 1;
-		case 'X':
-				// erase n(default 1) chars after cursor, don't move the cursor.
-			return 1;
+	switch (vt_csi_param(csi, 0, 0)) {
+		case 0: vt_grid_erase(g, g->y, x, g->cols, chan); break;
+		case 1: vt_grid_erase(g, g->y, 0, x + 1, chan); break;
+		case 2: vt_grid_erase(g, g->y, 0, g->cols, chan); break;
+	}
+	return 1;
+}
 
-		// Cursor moving functions
-		case 'd':	// Line position absolute (default 1)
-				
-			return 1;
-		case 'H':	// Move cursor to x, y (y is the first argument)
+// ECH: n characters from the cursor on, not past the end of line
+static int vt_ech(struct ncvtctx* vt, const struct vt_csi* csi) {
+	struct vt_grid* g = vt->grid;
+	int n = vt_csi_param(csi, 0, 1);
+	int x = g->x < g->cols ? g->x : g->cols - 1;
 
-			return 1;
-		
+	vt_grid_erase(g, g->y, x, x + (n ? n : 1), vt_erase_chan(vt));
+	return 1;
+}
 
-		case 'A': 
-		case 0x6D: return vt_sgr(s);	
-		default: return vt_unknown(s);
-	}
+// VPA: row n (1-based), same column
+static int vt_vpa(struct ncvtctx* vt, const struct vt_csi* csi) {
+	vt_grid_goto(vt->grid, vt_csi_param(csi, 0, 1) - 1, vt->grid->x);
+	return 1;
 }
 
-// Escape state - after detecting '\x1b'
-static int vt_esc(struct ncvtsms* s) {
-	s->pos++; if (vt_eob(s)) return vt_end(s);
+// CUP and HVP: row; column, both 1-based
+static int vt_cup(struct ncvtctx* vt, const struct vt_csi* csi) {
+	vt_grid_goto(vt->grid, vt_csi_param(csi, 0, 1) - 1, vt_csi_param(csi, 1, 1) - 1);
+	return 1;
+}
+
+static int vt_csi_unknown(struct ncvtctx* vt, const struct vt_csi* csi) {
+	return vt_unknown(vt, csi->priv ? VT_SEQ_CSI_PRIV : VT_SEQ_CSI, csi->final, csi);
+}
+
+// Known, but not done yet - same as unknown
+static int vt_csi_todo(struct ncvtctx* vt, const struct vt_csi* csi) {
+	return vt_csi_unknown(vt, csi);
+}
+
+// Switches between the screens. Only the pointer changes, the plane gets all of the new one at the next blit.
+static void vt_altscreen(struct ncvtctx* vt, bool on, bool cursor) {
+	struct vt_grid* g = on ? &vt->alt : &vt->screen;
 
-	switch (*vt_bfetch(s)) {
-		case 0x5B: return vt_csi(s); break;
-		default: return vt_unknown(s);
+	if (vt->grid == g) return;
+	if (on) {
+		if (cursor) {
+			vt->curmem_x = vt->grid->x;
+			vt->curmem_y = vt->grid->y;
+		}
+		vt_grid_clear(g);
+		g->x = vt->grid->x;
+		g->y = vt->grid->y;
+	}
+	else if (cursor) {
+		g->x = vt->curmem_x;
+		g->y = vt->curmem_y;
 	}
+	vt->grid = g;
+	vt_grid_touch_all(g);
 }
 
-// Parsing UTF-8 EGCs (including 1-byte ASCII)
-static int vt_utf8(struct ncvtsms* s) {
-	size_t cpl = utf8_codepoint_length(*vt_bfetch(s));
-	if (cpl <= vt_ppos(s) + 1){
-		int q;
-		if (ncplane_putegc(s->n, vt_bfetch(s), NULL) >= 0) {
-			s->pos += cpl - 1;
-			s->lop = s->pos; return 1;
+// DEC private modes, several may be set at once
+static int vt_csi_private(struct ncvtctx* vt, const struct vt_csi* csi) {
+	if (csi->priv != '?' || (csi->final != 'h' && csi->final != 'l')) return vt_csi_unknown(vt, csi);
+
+	bool set = csi->final == 'h';
+	bool known = true;
+	for (int i = 0; i < csi->n; i++) {
+		switch (vt_csi_param(csi, i, 0)) {
+			case 47:	// Alternate screen
+			case 1047:
+				vt_altscreen(vt, set, false);
+				break;
+			case 1049:	// Alternate screen, saving the cursor on the way there
+				vt_altscreen(vt, set, true);
+				break;
+			default:	// TODO: 7 (DECAWM), 25 (cursor), 1000 (mouse) etc.
+				known = false;
+				break;
 		}
 	}
-	return vt_end(s);
+	return known ? 1 : vt_csi_unknown(vt, csi);
+}
+
+// CSI functions, indexed by final byte - 0x40
+typedef int (*vt_csi_fn)(struct ncvtctx*, const struct vt_csi*);
+static const vt_csi_fn vt_csi_table[0x3F] = {
+	// Erase functions
+	['J' - 0x40] = vt_ed,		// Erase display
+	['K' - 0x40] = vt_el,		// Erase line
+	['X' - 0x40] = vt_ech,		// Erase characters
+
+	// Cursor moving functions
+	['A' - 0x40] = vt_csi_todo,	// Cursor up
+	['d' - 0x40] = vt_vpa,		// Line position absolute
+	['H' - 0x40] = vt_cup,		// Move cursor to y, x
+	['f' - 0x40] = vt_cup,
+
+	// Scrolling
+	['r' - 0x40] = vt_decstbm,
+	['S' - 0x40] = vt_scroll,
+	['T' - 0x40] = vt_scroll,
+
+	['m' - 0x40] = vt_sgr,
+};
+
+// Complete CSI, the function is picked by the final byte
+static int vt_csi(void* opaque, const struct vt_csi* csi) {
+	struct ncvtctx* vt = opaque;
+
+	if (csi->ninter) return vt_csi_unknown(vt, csi);	// Intermediate bytes aren't used by anything we support
+	if (csi->priv) return vt_csi_private(vt, csi);
 
+	vt_csi_fn f = vt_csi_table[csi->final - 0x40];
+	return f ? f(vt, csi) : vt_csi_unknown(vt, csi);
+}
+
+// OSC payloads go into vt->osc as they come, and are acted upon once terminated
+static int vt_osc_start(void* opaque) {
+	struct ncvtctx* vt = opaque;
+	vt_osc_reset(&vt->osc);
+	return 1;
+}
 
+static int vt_osc_put(void* opaque, const char* s, size_t len) {
+	struct ncvtctx* vt = opaque;
+	vt_osc_add(&vt->osc, s, len);
+	return 1;
 }
 
+static int vt_osc_end(void* opaque) {
+	struct ncvtctx* vt = opaque;
+	char* arg;
+	char* p;
+	long len;
+
+	int cmd = vt_osc_finish(&vt->osc, &arg);
+	switch (cmd) {
+		case 0:		// Icon name and window title
+		case 2:
+			snprintf(vt->title, sizeof(vt->title), "%s", arg);
+			return 1;
+		case 8:		// Hyperlink, "params;URI". Empty URI ends it.
+			if (!(p = strchr(arg, ';')) || strlen(p + 1) >= sizeof(vt->link)) p = "";
+			else p++;
+			strcpy(vt->link, p);
+			return 1;
+		case 52:	// Clipboard, "selections;base64". "?" asks for the clipboard, which isn't given away.
+			if (!vt->clipboard || !(p = strchr(arg, ';')) || !strcmp(++p, "?")) return 1;
+			if ((len = vt_base64_decode(p)) < 0) return 1;
+			return vt->clipboard(vt->clipboard_opaque, p, len) < 0 ? -1 : 1;
+		case -1:	// Too long or cancelled
+			return 1;
+		default:	// Colors (4, 10, 11), working directory (7) etc.
+			return vt_unknown(vt, VT_SEQ_OSC, cmd, NULL);
+	}
+}
+
+// No DCS is supported (DECRQSS, sixel...), its payload is skipped by the parser
+static int vt_dcs_hook(void* opaque, const struct vt_csi* seq) {
+	return vt_unknown(opaque, VT_SEQ_DCS, seq->final, NULL);
+}
+
+static const struct vt_parser_cb vt_callbacks = {
+	.print = vt_print,
+	.execute = vt_execute,
+	.esc = vt_esc,
+	.csi = vt_csi,
+	.osc_start = vt_osc_start,
+	.osc_put = vt_osc_put,
+	.osc_end = vt_osc_end,
+	.dcs_hook = vt_dcs_hook,
+};
+
 // -------------------- PUTVT
 
-ssize_t ncplane_putvt(struct ncplane* n, struct ncvtctx* vtctx, const char* buf, size_t s) {
+// Parses s bytes straight from buf into the grid. Sequences may be split between calls at any byte,
+// the parser state in vtctx takes care of that - nothing is copied or parsed twice.
+// Returns s, or negative on error.
+ssize_t vtctx_feed(struct ncvtctx* vtctx, const char* buf, size_t s) {
+	int r = vt_parser_feed(&vtctx->parser, buf, s);
+	return r < 0 ? r : (ssize_t) s;
+}
 
-	//ncplane_set_scrolling(n, 1);	// putvt makes sense only in scrollable planes.	
-	
-	// Initialize state
-	struct ncvtsms sms;
-	sms.n = n;
-	sms.vtctx = vtctx;
-	sms.pos = 0;
-	sms.lop = -1;
-
-	//fill vtctx with new buffer contents
-	if (vtctx->cs + s > vtctx->cbs) {
-		vtctx->cbuf = realloc(vtctx->cbuf, (vtctx->cs + s) * sizeof(char));
-		vtctx->cbs = vtctx->cs + s;
+// Brings the plane up to date with the grid, only rows that changed are written. If the plane was
+// resized the grids follow first, and so does the child's PTY.
+// Fits vt_pacer's prerender hook. In worker thread mode it must be called from the rendering thread,
+// and returns 1 if there's more output waiting to be parsed. Otherwise returns 0, or -1 on error.
+int vtctx_blit(void* opaque) {
+	struct ncvtctx* vt = opaque;
+	int r;
+
+	if (!vt->threaded) {
+		if (vtctx_attach(vt, vt->n) < 0) return -1;	// The plane may have been resized
+		return vt_grid_blit(vt->grid, vt->n) < 0 ? -1 : 0;
 	}
-	memcpy(vtctx->cbuf + vtctx->cs, buf, s);
-	vtctx->cs += s;	
+	pthread_mutex_lock(&vt->lock);
+	if (vtctx_attach(vt, vt->n) < 0) r = -1;
+	else r = vt_grid_blit(vt->grid, vt->n) < 0 ? -1 : !vt_ring_empty(&vt->ring);
+	pthread_mutex_unlock(&vt->lock);
+	return r;
+}
 
-	// The 'base' state is case in while loop, to avoid stack overflows with arbitrarily long buffers
-	char c;
-	int r;	// Return from state machine
-	do {
-		c = *vt_bfetch(&sms);	
+// Parses s bytes from buf and shows the result on n right away. Don't mix with worker thread mode.
+// Returns s, or negative on error.
+ssize_t ncplane_putvt(struct ncplane* n, struct ncvtctx* vtctx, const char* buf, size_t s) {
+	if (vtctx_attach(vtctx, n) < 0) return -1;
+	ssize_t r = vtctx_feed(vtctx, buf, s);
+	if (r < 0) return r;
+	return vtctx_blit(vtctx) < 0 ? -1 : r;
+}
 
-		if (c >= 0xC0 && c < 0xFE) {	// UTF-8 EGC
-			r = vt_utf8(&sms);
+// Lists the unsupported sequences counted so far, one per line with the count
+void vtctx_dump_unknown(const struct ncvtctx* vtctx, FILE* fp) {
+	static const char* kinds[VT_SEQ_KINDS] = { "ESC", "CSI", "CSI", "OSC", "DCS" };
+
+	for (int k = 0; k < VT_SEQ_KINDS; k++) {
+		for (int key = 0; key < 128; key++) {
+			if (!vtctx->unknown[k][key]) continue;
+			if (k == VT_SEQ_OSC) fprintf(fp, "OSC %d%s", key, key == 127 ? "+" : "");
+			else if (k == VT_SEQ_ESC && key < 0x30) fprintf(fp, "ESC %c*", key);	// Any final after this intermediate
+			else fprintf(fp, "%s %s%c", kinds[k], k == VT_SEQ_CSI_PRIV ? "(private) " : "", key);
+			fprintf(fp, "\t%u\n", vtctx->unknown[k][key]);
 		}
-		else {
-			switch (c) {	// Other cases
-				case 0x1B: r = vt_esc(&sms); break;
-				default: r = vt_utf8(&sms);
-				
-			}
-		}
-		if (r == 1){
-			sms.pos++; if (vt_eob(&sms)) r = vt_end(&sms);
+	}
+}
+
+// -------------------- PTY
+
+// Output only goes to the grid, vtctx_blit shows it
+static int vt_pty_output(void* opaque, const char* buf, size_t len) {
+	struct ncvtctx* vt = opaque;
+	if (vt->threaded) return vt_ring_put(&vt->ring, buf, len) == len ? 1 : -1;	// Fits, the loop asked vt_pty_room
+	return vtctx_feed(vt, buf, len) < 0 ? -1 : 1;
+}
+
+// In worker thread mode the loop reads no more than the ring takes, and stops reading while it's full
+static size_t vt_pty_room(void* opaque) {
+	struct ncvtctx* vt = opaque;
+	if (atomic_load(&vt->ring.closed)) return 1;	// The worker is gone, the next output fails and closes the PTY
+	return vt_ring_room(&vt->ring);
+}
+
+// Runs argv on a PTY sized like the plane n, its output goes to n through vtctx_blit.
+// Add vtctx->pty to a vt_loop to get it going. Returns 0, or -1 if the child couldn't be started.
+int vtctx_spawn(struct ncvtctx* vtctx, struct ncplane* n, char* const argv[]) {
+	if (vtctx_attach(vtctx, n) < 0) return -1;
+	vtctx->pty.output = vt_pty_output;
+	vtctx->pty.opaque = vtctx;
+	return vt_pty_spawn(&vtctx->pty, argv, vtctx->grid->rows, vtctx->grid->cols);
+}
+
+// -------------------- WORKER THREAD
+// The thread reading PTYs only drops bytes into the ring, each terminal is parsed on its own thread
+// into its grid, and the rendering thread blits the rows that changed right before a render.
+
+#define VT_WORKER_SLICE (16 << 10)	// Parsed under the lock at once, a blit waits for one slice at most
+
+static void* vt_worker(void* arg) {
+	struct ncvtctx* vt = arg;
+	const char* p;
+	size_t len;
+
+	while ((len = vt_ring_rspan(&vt->ring, &p))) {
+		if (len > VT_WORKER_SLICE) len = VT_WORKER_SLICE;
+		pthread_mutex_lock(&vt->lock);
+		int r = vt_parser_feed(&vt->parser, p, len);
+		vt_ring_consume(&vt->ring, len);
+		pthread_mutex_unlock(&vt->lock);
+		vt_pty_resume(&vt->pty);	// The loop may be waiting for room
+		if (r < 0) {
+			vt_ring_close(&vt->ring);	// The next output fails and the loop closes the PTY
+			vt_pty_resume(&vt->pty);
+			break;
 		}
 	}
-	while (r == 1);
+	return NULL;
+}
+
+// Moves parsing of the PTY output to a thread of its own, with a ring of ringsize bytes in between.
+// Call after vtctx_spawn. Returns 0, or -1 if something couldn't be created.
+int vtctx_start_worker(struct ncvtctx* vtctx, size_t ringsize) {
+	if (vt_ring_init(&vtctx->ring, ringsize, &vtctx->arena) < 0) return -1;
+	pthread_mutex_init(&vtctx->lock, NULL);
+	vtctx->threaded = true;
+	vtctx->pty.room = vt_pty_room;
+	if (pthread_create(&vtctx->worker, NULL, vt_worker, vtctx)) {
+		vtctx->threaded = false;
+		vtctx->pty.room = NULL;
+		pthread_mutex_destroy(&vtctx->lock);
+		vt_ring_fini(&vtctx->ring);
+		return -1;
+	}
+	return 0;
+}
+
+// Lets the worker parse whatever is left in the ring, and takes down the thread, the lock and the ring
+static void vt_worker_join(struct ncvtctx* vtctx) {
+	vt_ring_close(&vtctx->ring);
+	pthread_join(vtctx->worker, NULL);
+	vtctx->threaded = false;
+	vtctx->pty.room = NULL;
+	vt_pty_resume(&vtctx->pty);	// Parsed inline from now on, there's always room
+	pthread_mutex_destroy(&vtctx->lock);
+	vt_ring_fini(&vtctx->ring);
+}
 
-	return sms.lop;	// Might actually be greater than s, if cbuf wasn't empty.
+// Parses whatever is left in the ring, blits it and goes back to inline parsing.
+void vtctx_stop_worker(struct ncvtctx* vtctx) {
+	vt_worker_join(vtctx);
+	vtctx_blit(vtctx);
 }
 
 // --------------------- MAIN (proof-of-concept test)
+// Build with -DNCVT_NO_MAIN to use the rest from another program (ncvtbench.c)
 
+#ifndef NCVT_NO_MAIN
 int main()
 {
 
@@ -409,41 +608,52 @@ int main()
 	setlocale(LC_ALL, "");
 
 	struct ncplane_options defopts = {.y=10, .x=20, .rows=30, .cols=80};
-	struct ncplane* t0 = ncplane_create(notcurses_stdplane(nc), &defopts);
-	ncplane_set_scrolling(t0, 1);
+	struct ncplane* t0 = ncplane_create(notcurses_stdplane(nc), &defopts);	// The grid scrolls, not the plane
 
 	ncplane_putstr(t0, "Oto terminal nr 0, woohoo!\n"); 
 	notcurses_render(nc);
 
 	struct ncvtctx t0ctx;
-	t0ctx.cbs = 1;
-	t0ctx.cbuf = (char*) malloc (t0ctx.cbs * sizeof(char)); // TODO - needs to be freed someday...
-	t0ctx.cs = 0;	// TODO: more elegant (and complete) vtctx initializer
-
-	FILE *fp;
-	char buf[256];
-	size_t s;
-
-	//fp = popen("cat 24bit.pattern", "r");
-	fp = popen("echo ⢠⠃⠀⡠⠞⠉⠀⠀⠉⠣ \ntoilet --gay Dupa", "r");
-	//fp = popen("unbuffer -efq ls /home/mctom", "r");
-	if (fp == NULL) {
+	vtctx_init(&t0ctx);
+	if (notcurses_palette_size(nc) >= 256) t0ctx.palette = NULL;	// Terminal has the palette, no need for RGB
+
+	struct vt_pacer pacer;
+	vt_pacer_init(&pacer, nc, 60);
+
+	//char* cmd[] = {"cat", "24bit.pattern", NULL};
+	char* cmd[] = {"sh", "-c", "echo ⢠⠃⠀⡠⠞⠉⠀⠀⠉⠣; toilet --gay Dupa", NULL};
+	//char* cmd[] = {"ls", "--color", "/home/mctom", NULL};
+	if (vtctx_spawn(&t0ctx, t0, cmd) < 0) {
 		printf("Failed to run command\n" );
 		exit(1);
 	}
 
-	while (s = fread(buf, sizeof(char), sizeof(buf), fp)) {
-  		//ncplane_putnstr(t0, s, buf); 
-		ncplane_putvt(t0, &t0ctx, buf, s);
+	if (getenv("NCVT_SHOW_UNKNOWN")) t0ctx.unknown_policy = VT_UNKNOWN_SHOW;
+	if (getenv("NCVT_THREADED")) vtctx_start_worker(&t0ctx, 1 << 20);	// Parse on a worker thread
+	pacer.prerender = vtctx_blit;
+	pacer.opaque = &t0ctx;
+
+	// Output is parsed as soon as it arrives, renders happen only when a frame is due or the command goes quiet
+	struct vt_loop loop;
+	if (vt_loop_init(&loop, &pacer) < 0) exit(1);
+	vt_loop_add(&loop, &t0ctx.pty);
+	vt_loop_run(&loop);
+	vt_loop_fini(&loop);
+	if (t0ctx.threaded) {
+		vtctx_stop_worker(&t0ctx);
 		notcurses_render(nc);
 	}
 
-	pclose(fp);
-
 	system("sleep 5");	// for some reason putchar() doesn't work here.
 
 	notcurses_stop(nc);
+	printf("%llu bytes parsed, %llu frames rendered\n",
+		(unsigned long long) pacer.bytes, (unsigned long long) pacer.frames);
+	if (vt_width_init() < 0) printf("No UTF-8 locale, every codepoint took one cell\n");
+	vtctx_dump_unknown(&t0ctx, stdout);
+	vtctx_fini(&t0ctx);
 
 	return 0;
 
 }
+#endif
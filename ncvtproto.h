@@ -0,0 +1,95 @@
+#ifndef NCVTPROTO_H
+#define NCVTPROTO_H
+
+#include "notcurses/notcurses.h"
+#include "vt_parser.h"
+#include "vt_grid.h"
+#include "vt_scrollback.h"
+#include "vt_pace.h"
+#include "vt_pty.h"
+#include "vt_ring.h"
+#include "vt_osc.h"
+#include "vt_arena.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+// A terminal on a notcurses plane: feed it what a program writes, and the plane shows what a terminal would.
+
+// What happens to sequences that aren't supported
+enum vt_unknown_policy {
+	VT_UNKNOWN_SWALLOW,	// Ignored
+	VT_UNKNOWN_COUNT,	// Counted in vtctx->unknown, the default
+	VT_UNKNOWN_SHOW,	// Counted, and ESC and CSI ones printed on the grid in one piece, for debugging
+};
+
+enum vt_seq_kind {
+	VT_SEQ_ESC,
+	VT_SEQ_CSI,
+	VT_SEQ_CSI_PRIV,	// With a private marker ('?', '>' ...)
+	VT_SEQ_OSC,
+	VT_SEQ_DCS,
+	VT_SEQ_KINDS
+};
+
+#define VT_CTX_ARENA (4 << 20)	// First chunk of a context's arena: the grids and scrollback of a usual terminal
+
+struct ncvtctx {	// VT context
+	struct vt_arena arena;	// Everything below allocates here. Set arena.chunk and arena.huge before
+				// the first output to size it otherwise.
+	struct ncplane* n;	// Plane the grid is blitted to, set by ncplane_putvt or vtctx_spawn
+	struct vt_grid* grid;	// Screen contents, the parser only ever changes this. Points to one of:
+	struct vt_grid screen;	// Normal screen
+	struct vt_grid alt;	// Alternate screen (\e[?1049h), same size, no scrollback
+	struct vt_scrollback sb;	// Lines scrolled off the grid. Take the lock to read it in worker thread mode.
+	int curmem_x;
+	int curmem_y;
+	uint64_t channels;	// Colors set by SGR, applied to whatever gets printed next
+	const uint32_t* palette;	// 256 colors for 3/4/8-bit SGRs (see vt_colors.h), or NULL to keep them as palette indices
+	struct vt_parser parser;	// Keeps track of sequences split between ncplane_putvt calls
+	struct vt_osc osc;	// OSC payload being collected
+	enum vt_unknown_policy unknown_policy;
+	uint32_t unknown[VT_SEQ_KINDS][128];	// Unsupported sequences seen, by final byte, ESC intermediate
+						// or OSC number (127 and up together)
+
+	// Set by OSC. Take the lock to read them in worker thread mode.
+	char title[256];	// Window title
+	char link[1024];	// URI of the OSC 8 hyperlink being printed, or "". Cells don't keep it yet.
+	int (*clipboard)(void* opaque, const char* data, size_t len);	// OSC 52 copy, NULL to ignore it. Called
+	void* clipboard_opaque;						// on the worker in worker thread mode.
+	struct vt_pty pty;	// Child process feeding this terminal, if started with vtctx_spawn
+
+	// Worker thread mode (vtctx_start_worker): the grid is parsed into on the worker,
+	// and blitted to n by the rendering thread.
+	bool threaded;
+	struct vt_ring ring;	// PTY output waiting to be parsed
+	pthread_t worker;
+	pthread_mutex_t lock;	// Held while the grid is being changed or blitted
+};
+
+// Sets up a fresh VT context. The grid is allocated once a plane comes along, vtctx_fini frees it.
+void vtctx_init(struct ncvtctx* vtctx);
+// Frees everything at once, however much scrollback there is. A worker still running is stopped
+// without a blit, the PTY is left to vt_pty_close.
+void vtctx_fini(struct ncvtctx* vtctx);
+
+// Parses s bytes from buf and shows the result on n right away. Don't mix with worker thread mode.
+// Returns s, or negative on error.
+ssize_t ncplane_putvt(struct ncplane* n, struct ncvtctx* vtctx, const char* buf, size_t s);
+
+// Parses into the grid only, vtctx_blit brings the plane up to date. Returns s, or negative on error.
+ssize_t vtctx_feed(struct ncvtctx* vtctx, const char* buf, size_t s);
+int vtctx_blit(void* opaque);
+
+// Lists the unsupported sequences counted so far, one per line with the count
+void vtctx_dump_unknown(const struct ncvtctx* vtctx, FILE* fp);
+
+// Runs argv on a PTY sized like the plane n, its output goes to n through vtctx_blit.
+// Add vtctx->pty to a vt_loop to get it going. Returns 0, or -1 if the child couldn't be started.
+int vtctx_spawn(struct ncvtctx* vtctx, struct ncplane* n, char* const argv[]);
+
+// Parsing on a thread of its own, see ncvtproto.c
+int vtctx_start_worker(struct ncvtctx* vtctx, size_t ringsize);
+void vtctx_stop_worker(struct ncvtctx* vtctx);
+
+#endif
@@ -0,0 +1,78 @@
+#include "vt_arena.h"
+#include <sys/mman.h>
+
+struct vt_arena_chunk {
+	struct vt_arena_chunk* prev;
+	size_t size;
+	char pad[48];	// Keeps what follows on a cache line
+};
+
+void vt_arena_init(struct vt_arena* a, size_t chunk, bool huge) {
+	memset(a, 0, sizeof(*a));
+	a->chunk = chunk < VT_ARENA_MIN ? VT_ARENA_MIN : chunk;
+	a->huge = huge;
+}
+
+void vt_arena_fini(struct vt_arena* a) {
+	struct vt_arena_chunk* c = a->last;
+	while (c) {
+		struct vt_arena_chunk* prev = c->prev;
+		munmap(c, c->size);
+		c = prev;
+	}
+	vt_arena_init(a, a->chunk, a->huge);
+}
+
+// Class of n bytes, and their size rounded up to it: 64, then four steps to each power of 2
+static inline unsigned vt_arena_class(size_t n, size_t* size) {
+	if (n < 64) n = 64;
+	unsigned lg = 63 - __builtin_clzll(n - 1);	// 2^lg < n <= 2^(lg+1)
+	size_t step = (size_t) 1 << (lg - 2);
+	*size = (n + step - 1) & ~(step - 1);		// 5, 6, 7 or 8 steps
+	return (lg - 5) * 4 + (unsigned) (*size >> (lg - 2)) - 5;
+}
+
+// A new chunk with room for n bytes. What was left in the old one is lost.
+static int vt_arena_grow(struct vt_arena* a, size_t n) {
+	size_t size = a->chunk;
+	while (size < n + sizeof(struct vt_arena_chunk)) size *= 2;
+	struct vt_arena_chunk* c = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (c == MAP_FAILED) return -1;
+#ifdef MADV_HUGEPAGE
+	if (a->huge) madvise(c, size, MADV_HUGEPAGE);	// Only a hint, it doesn't matter if it's refused
+#endif
+	c->prev = a->last;
+	c->size = size;
+	a->last = c;
+	a->next = (char*) (c + 1);
+	a->end = (char*) c + size;
+	a->mapped += size;
+	if (a->chunk < VT_ARENA_MAXCHUNK) a->chunk *= 2;
+	return 0;
+}
+
+void* vt_arena_alloc(struct vt_arena* a, size_t n, bool zero) {
+	size_t size;
+	unsigned k = vt_arena_class(n, &size);
+	void* p;
+
+	if (k >= VT_ARENA_CLASSES) return NULL;
+	if ((p = a->free[k])) {
+		a->free[k] = *(void**) p;
+		if (zero) memset(p, 0, size);
+		return p;
+	}
+	if ((size_t) (a->end - a->next) < size && vt_arena_grow(a, size) < 0) return NULL;
+	p = a->next;	// Fresh from mmap, zero already
+	a->next += size;
+	return p;
+}
+
+void vt_arena_free(struct vt_arena* a, void* p, size_t n) {
+	size_t size;
+	unsigned k = vt_arena_class(n, &size);
+
+	if (p == NULL) return;
+	*(void**) p = a->free[k];
+	a->free[k] = p;
+}
@@ -0,0 +1,56 @@
+#ifndef VT_ARENA_H
+#define VT_ARENA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Memory of one terminal: grids, clusters, scrollback, the worker ring. It's mapped in big chunks,
+// handed out from the newest one, and whatever is freed goes to a list by size to be used again.
+// Nothing reaches the heap, and vt_arena_fini unmaps it all at once, without freeing piece by piece.
+// Not thread safe, in worker thread mode everything that allocates runs under the context lock.
+//
+// Sizes are rounded up to classes four to a power of 2, so reuse wastes at most a quarter.
+
+#define VT_ARENA_CLASSES 176
+#define VT_ARENA_MIN (1 << 20)		// Smallest chunk
+#define VT_ARENA_MAXCHUNK (64 << 20)	// Chunks double up to this, or whatever a single allocation needs
+
+struct vt_arena_chunk;
+
+struct vt_arena {
+	size_t chunk;		// Size of the next chunk to map. Set before the first allocation to size the first one.
+	bool huge;		// Ask for transparent hugepages, worth it with deep scrollback
+	struct vt_arena_chunk* last;	// Newest chunk, the older ones are linked from it
+	char* next;		// Free space in the newest chunk
+	char* end;
+	void* free[VT_ARENA_CLASSES];	// Freed blocks by class, linked through their first word
+	size_t mapped;		// Bytes in all the chunks
+};
+
+// Nothing is mapped until the first allocation
+void vt_arena_init(struct vt_arena* a, size_t chunk, bool huge);
+// Unmaps every chunk, all the memory handed out is gone. The arena is empty and can be used again.
+void vt_arena_fini(struct vt_arena* a);
+
+// Returns NULL if out of memory. zero - clear it, only blocks used before need that.
+void* vt_arena_alloc(struct vt_arena* a, size_t n, bool zero);
+// n must be the size it was allocated with. NULL is ignored.
+void vt_arena_free(struct vt_arena* a, void* p, size_t n);
+
+// For modules that work with or without an arena: NULL means the heap.
+static inline void* vt_alloc(struct vt_arena* a, size_t n) {
+	return a ? vt_arena_alloc(a, n, false) : malloc(n);
+}
+
+static inline void* vt_zalloc(struct vt_arena* a, size_t n) {
+	return a ? vt_arena_alloc(a, n, true) : calloc(1, n);
+}
+
+static inline void vt_free(struct vt_arena* a, void* p, size_t n) {
+	if (a) vt_arena_free(a, p, n);
+	else free(p);
+}
+
+#endif
@@ -1,26 +1,90 @@
 #include "notcurses/notcurses.h"
+#include "vt_colors.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-// Please create a header file for this!
+// Palettes are built by the preprocessor, so there's no arithmetic left for run time.
+// color code table: https://en.wikipedia.org/wiki/ANSI_escape_code#8-bit
 
-int vt_4bc(struct ncplane* n, char c) {
-	// Here convert 4-bit color code from 'c' into a notcurses call
-	// color code table: https://en.wikipedia.org/wiki/ANSI_escape_code#3-bit_and_4-bit
-	// Assume VGA palette for now.
-	// Return '-1' on failure, and '1' if succeeded.
-	
-	// ncplane_set_fg_rgb8(n, red, green, blue)
-	// ncplane_set_bg_rgb8(n, red, green, blue)
+#define RGB(r, g, b) ((uint32_t)(r) << 16 | (uint32_t)(g) << 8 | (uint32_t)(b))
+
+// 6x6x6 cube, L() maps level 0-5 to a color component
+#define CUBE_B(L, r, g) RGB(L(r), L(g), L(0)), RGB(L(r), L(g), L(1)), RGB(L(r), L(g), L(2)), \
+			RGB(L(r), L(g), L(3)), RGB(L(r), L(g), L(4)), RGB(L(r), L(g), L(5))
+#define CUBE_G(L, r)	CUBE_B(L, r, 0), CUBE_B(L, r, 1), CUBE_B(L, r, 2), \
+			CUBE_B(L, r, 3), CUBE_B(L, r, 4), CUBE_B(L, r, 5)
+#define CUBE(L)		CUBE_G(L, 0), CUBE_G(L, 1), CUBE_G(L, 2), \
+			CUBE_G(L, 3), CUBE_G(L, 4), CUBE_G(L, 5)
+
+// 24 step grayscale ramp, 8..238
+#define GRAY1(i) RGB(8 + 10 * (i), 8 + 10 * (i), 8 + 10 * (i))
+#define GRAY4(i) GRAY1(i), GRAY1(i + 1), GRAY1(i + 2), GRAY1(i + 3)
+#define GRAY GRAY4(0), GRAY4(4), GRAY4(8), GRAY4(12), GRAY4(16), GRAY4(20)
+
+#define VGA_LEVEL(x) ((x) * 51)
+#define XTERM_LEVEL(x) ((x) ? 55 + (x) * 40 : 0)
+
+const uint32_t vt_pal_vga[256] = {
+	RGB(0, 0, 0),		RGB(170, 0, 0),		RGB(0, 170, 0),		RGB(170, 170, 0),
+	RGB(0, 0, 170),		RGB(170, 0, 170),	RGB(0, 170, 170),	RGB(170, 170, 170),
+	RGB(85, 85, 85),	RGB(255, 85, 85),	RGB(85, 255, 85),	RGB(255, 255, 85),
+	RGB(85, 85, 255),	RGB(255, 85, 255),	RGB(85, 255, 255),	RGB(255, 255, 255),
+	CUBE(VGA_LEVEL),
+	GRAY,
+};
+
+const uint32_t vt_pal_xterm[256] = {
+	RGB(0, 0, 0),		RGB(205, 0, 0),		RGB(0, 205, 0),		RGB(205, 205, 0),
+	RGB(0, 0, 238),		RGB(205, 0, 205),	RGB(0, 205, 205),	RGB(229, 229, 229),
+	RGB(127, 127, 127),	RGB(255, 0, 0),		RGB(0, 255, 0),		RGB(255, 255, 0),
+	RGB(92, 92, 255),	RGB(255, 0, 255),	RGB(0, 255, 255),	RGB(255, 255, 255),
+	CUBE(XTERM_LEVEL),
+	GRAY,
+};
+
+const uint32_t* vt_palette(enum vt_palette_profile profile) {
+	switch (profile) {
+		case VT_PAL_XTERM: return vt_pal_xterm;
+		default: return vt_pal_vga;
+	}
+}
+
+int vt_palette_load(uint32_t pal[256], const char* path) {
+	FILE* fp = fopen(path, "r");
+	char line[128];
+	unsigned idx, rgb;
+	int loaded = 0;
+
+	if (fp == NULL) return -1;
+	memcpy(pal, vt_pal_xterm, sizeof(vt_pal_xterm));
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%u #%x", &idx, &rgb) == 2 && idx < 256) {
+			pal[idx] = rgb & 0xFFFFFF;
+			loaded++;
+		}
+	}
+	fclose(fp);
+	return loaded;
+}
+
+int vt_4bc(const uint32_t* pal, uint64_t* channels, int code) {
+	// 30-37 fg, 40-47 bg, 90-97 bright fg, 100-107 bright bg
+	if (code >= 30 && code <= 37) return vt_8bc(pal, channels, code - 30, 1);
+	if (code >= 40 && code <= 47) return vt_8bc(pal, channels, code - 40, 0);
+	if (code >= 90 && code <= 97) return vt_8bc(pal, channels, code - 82, 1);
+	if (code >= 100 && code <= 107) return vt_8bc(pal, channels, code - 92, 0);
+	return -1;
 }
 
-int vt_8bc(struct ncplane* n, char c, bool fg) {
-	// Here convert 8-bit color code from 'c' into a notcurses call
-	// if (fg), apply the change to fg, else to bg.
-	// color code table: https://en.wikipedia.org/wiki/ANSI_escape_code#8-bit
-	// Again, assume VGA pallete for lowest 16 codes.
-	// Return '-1' on failure, and '1' if succeeded
-	// (although in this case there are no invalid color codes, only ncplane calls may fail).
-	
-	// ncplane_set_fg_rgb8(n, red, green, blue)
-	// ncplane_set_bg_rgb8(n, red, green, blue)
+int vt_8bc(const uint32_t* pal, uint64_t* channels, int idx, bool fg) {
+	if (idx < 0 || idx > 255) return -1;
+	if (pal == NULL) {
+		if (fg) ncchannels_set_fg_palindex(channels, idx);
+		else    ncchannels_set_bg_palindex(channels, idx);
+		return 1;
+	}
+	if (fg) ncchannels_set_fg_rgb(channels, pal[idx]);
+	else    ncchannels_set_bg_rgb(channels, pal[idx]);
+	return 1;
 }
@@ -0,0 +1,33 @@
+#ifndef VT_COLORS_H
+#define VT_COLORS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 256 color palettes, as packed 0xRRGGBB.
+// Entries 0-15 are the 3/4-bit colors, 16-231 the 6x6x6 color cube, 232-255 the grayscale ramp.
+
+enum vt_palette_profile {
+	VT_PAL_VGA,	// VGA text mode colors, even 0-255 cube
+	VT_PAL_XTERM,	// xterm defaults
+};
+
+extern const uint32_t vt_pal_vga[256];
+extern const uint32_t vt_pal_xterm[256];
+
+const uint32_t* vt_palette(enum vt_palette_profile profile);
+
+// Loads a user palette from a text file, one "index #RRGGBB" per line (# comments allowed).
+// Entries missing from the file keep xterm colors. Returns number of entries loaded, or -1 if the file can't be read.
+int vt_palette_load(uint32_t pal[256], const char* path);
+
+// Sets the color picked by SGR code 30-37, 40-47, 90-97 or 100-107 in channels.
+// Return '-1' for any other code, and '1' if succeeded.
+int vt_4bc(const uint32_t* pal, uint64_t* channels, int code);
+
+// Sets palette entry idx as the foreground (fg) or background color in channels.
+// If pal is NULL, idx is kept as a palette index, to be resolved by the terminal's own palette.
+// Return '-1' if idx is out of range, and '1' if succeeded.
+int vt_8bc(const uint32_t* pal, uint64_t* channels, int idx, bool fg);
+
+#endif
@@ -0,0 +1,98 @@
+#include "vt_glyphs.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define VT_GLYPHS_SLOTS (2 * VT_GLYPHS_MAX)	// Power of 2, half full at most
+
+static uint32_t vt_glyph_hash(const char* s, size_t len) {
+	uint32_t h = 2166136261u;	// FNV-1a
+	for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char) s[i]) * 16777619u;
+	return h;
+}
+
+void vt_glyphs_init(struct vt_glyphs* p, struct vt_arena* mem) {
+	memset(p, 0, sizeof(*p));
+	p->mem = mem;
+}
+
+void vt_glyphs_fini(struct vt_glyphs* p) {
+	vt_free(p->mem, p->ent, VT_GLYPHS_MAX * sizeof(*p->ent));
+	vt_free(p->mem, p->slot, VT_GLYPHS_SLOTS * sizeof(*p->slot));
+	vt_free(p->mem, p->arena, VT_GLYPHS_ARENA);
+	vt_glyphs_init(p, p->mem);
+}
+
+// Everything is allocated with the first cluster, most terminals never see one
+static int vt_glyphs_alloc(struct vt_glyphs* p) {
+	p->ent = vt_alloc(p->mem, VT_GLYPHS_MAX * sizeof(*p->ent));
+	p->slot = vt_zalloc(p->mem, VT_GLYPHS_SLOTS * sizeof(*p->slot));
+	p->arena = vt_alloc(p->mem, VT_GLYPHS_ARENA);
+	if (p->ent && p->slot && p->arena) return 0;
+	vt_glyphs_fini(p);
+	return -1;
+}
+
+static void vt_glyphs_insert(struct vt_glyphs* p, uint32_t idx) {
+	uint32_t s = p->ent[idx].hash & (VT_GLYPHS_SLOTS - 1);
+	while (p->slot[s]) s = (s + 1) & (VT_GLYPHS_SLOTS - 1);
+	p->slot[s] = idx + 1;
+}
+
+uint32_t vt_glyphs_intern(struct vt_glyphs* p, const char* s, size_t len) {
+	uint32_t h = vt_glyph_hash(s, len);
+
+	if (p->ent == NULL && vt_glyphs_alloc(p) < 0) return 0;
+	for (uint32_t i = h & (VT_GLYPHS_SLOTS - 1); p->slot[i]; i = (i + 1) & (VT_GLYPHS_SLOTS - 1)) {
+		const struct vt_glyph* e = &p->ent[p->slot[i] - 1];
+		if (e->hash == h && e->len == len && !memcmp(p->arena + e->off, s, len))
+			return (p->slot[i] - 1) | VT_GLYPH_POOLED;
+	}
+	if (p->n == VT_GLYPHS_MAX || p->used + len > VT_GLYPHS_ARENA) return 0;
+
+	struct vt_glyph* e = &p->ent[p->n];
+	e->off = p->used;
+	e->len = len;
+	e->hash = h;
+	memcpy(p->arena + p->used, s, len);
+	p->used += len;
+	vt_glyphs_insert(p, p->n);
+	return p->n++ | VT_GLYPH_POOLED;
+}
+
+int vt_glyphs_sweep(struct vt_glyphs* p, uint32_t* glyphs, size_t n) {
+	if (p->ent == NULL) return 0;
+	size_t remap_size = (p->n ? p->n : 1) * sizeof(uint32_t);
+	uint32_t* remap = vt_zalloc(p->mem, remap_size);	// Old index -> new id, 0 - unused
+	char* arena = vt_alloc(p->mem, VT_GLYPHS_ARENA);
+	if (remap == NULL || arena == NULL) {
+		vt_free(p->mem, remap, remap_size);
+		vt_free(p->mem, arena, VT_GLYPHS_ARENA);
+		return -1;
+	}
+
+	for (size_t i = 0; i < n; i++)
+		if (vt_glyph_pooled(glyphs[i])) remap[glyphs[i] & ~VT_GLYPH_POOLED] = 1;
+
+	// Survivors keep their order, packed at the start of the arena
+	uint32_t k = 0, used = 0;
+	for (uint32_t i = 0; i < p->n; i++) {
+		if (!remap[i]) continue;
+		struct vt_glyph e = p->ent[i];
+		memcpy(arena + used, p->arena + e.off, e.len);
+		e.off = used;
+		used += e.len;
+		p->ent[k] = e;
+		remap[i] = k++ | VT_GLYPH_POOLED;
+	}
+	for (size_t i = 0; i < n; i++)
+		if (vt_glyph_pooled(glyphs[i])) glyphs[i] = remap[glyphs[i] & ~VT_GLYPH_POOLED];
+
+	vt_free(p->mem, p->arena, VT_GLYPHS_ARENA);
+	vt_free(p->mem, remap, remap_size);
+	p->arena = arena;
+	p->used = used;
+	p->n = k;
+	memset(p->slot, 0, VT_GLYPHS_SLOTS * sizeof(*p->slot));
+	for (uint32_t i = 0; i < k; i++) vt_glyphs_insert(p, i);
+	return k;
+}
@@ -0,0 +1,56 @@
+#ifndef VT_GLYPHS_H
+#define VT_GLYPHS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "vt_arena.h"
+
+// Interned glyphs. A cell holds a plain codepoint when its glyph is a single one, which is the
+// usual case; clusters (base + combining marks) are kept here once, and cells refer to them by id.
+// Ids have VT_GLYPH_POOLED set, so they never collide with codepoints.
+//
+// The pool is bounded. When it fills up, vt_glyphs_sweep drops everything the screen doesn't use anymore.
+
+#define VT_GLYPH_POOLED 0x80000000u
+#define VT_GLYPHS_MAX 4096		// Clusters in the pool
+#define VT_GLYPHS_ARENA (64 * 1024)	// Bytes of UTF-8 for all of them
+#define VT_GLYPH_MAXLEN 32		// Longest cluster kept, longer ones lose the extra marks
+
+struct vt_glyph {
+	uint32_t off;	// In the arena
+	uint16_t len;
+	uint32_t hash;
+};
+
+struct vt_glyphs {
+	struct vt_glyph* ent;
+	uint32_t* slot;		// Open addressing on hash, entry index + 1, 0 - empty
+	char* arena;
+	uint32_t n;		// Entries in use
+	uint32_t used;		// Arena bytes in use
+	struct vt_arena* mem;	// Where all that comes from, NULL - the heap
+};
+
+void vt_glyphs_init(struct vt_glyphs* p, struct vt_arena* mem);
+void vt_glyphs_fini(struct vt_glyphs* p);
+
+static inline int vt_glyph_pooled(uint32_t glyph) {
+	return (glyph & VT_GLYPH_POOLED) && glyph != 0xFFFFFFFFu;	// Not VT_GLYPH_TAIL
+}
+
+// Returns the id of cluster s (len bytes of UTF-8), adding it if needed.
+// Returns 0 if the pool is full or can't be allocated - sweep and try again.
+uint32_t vt_glyphs_intern(struct vt_glyphs* p, const char* s, size_t len);
+
+// UTF-8 of a pooled glyph
+static inline const char* vt_glyphs_get(const struct vt_glyphs* p, uint32_t glyph, size_t* len) {
+	const struct vt_glyph* e = &p->ent[glyph & ~VT_GLYPH_POOLED];
+	*len = e->len;
+	return p->arena + e->off;
+}
+
+// Evicts every cluster not referenced from glyphs[0..n), and renumbers the ones left there.
+// Returns the number of clusters left, or -1 if out of memory (nothing changes then).
+int vt_glyphs_sweep(struct vt_glyphs* p, uint32_t* glyphs, size_t n);
+
+#endif
@@ -0,0 +1,444 @@
+#include "vt_grid.h"
+#include "vt_utf8.h"
+#include "vt_scan.h"
+#include "vt_width.h"
+#include "vt_scrollback.h"
+#include "notcurses/notcurses.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Cell arrays, dirty bits and the blit buffer live in one allocation
+static size_t vt_grid_bytes(int rows, int cols) {
+	size_t cells = (size_t) rows * cols;
+	return cells * (sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint16_t))
+		+ (rows + 63) / 64 * sizeof(uint64_t) + rows * sizeof(int) + (size_t) cols * VT_GLYPH_MAXLEN;
+}
+
+static int vt_grid_alloc(struct vt_grid* g, int rows, int cols) {
+	size_t cells = (size_t) rows * cols;
+	size_t words = (rows + 63) / 64;
+	char* m = vt_zalloc(g->mem, vt_grid_bytes(rows, cols));
+	if (m == NULL) return -1;
+	g->chan = (uint64_t*) m;
+	g->dirty = (uint64_t*) (m + cells * sizeof(uint64_t));
+	g->row = (int*) (g->dirty + words);
+	g->glyph = (uint32_t*) (g->row + rows);
+	g->attr = (uint16_t*) (g->glyph + cells);
+	g->line = (char*) (g->attr + cells);
+	g->rows = rows;
+	g->cols = cols;
+	g->top = 0;
+	g->bot = rows - 1;
+	for (int y = 0; y < rows; y++) g->row[y] = y;
+	return 0;
+}
+
+int vt_grid_init(struct vt_grid* g, int rows, int cols, struct vt_arena* mem) {
+	vt_width_init();
+	g->mem = mem;
+	g->join = vt_zalloc(mem, VT_JOIN_SETS * 2 * sizeof(*g->join));
+	if (g->join == NULL) return -1;
+	if (vt_grid_alloc(g, rows, cols) < 0) {
+		vt_free(mem, g->join, VT_JOIN_SETS * 2 * sizeof(*g->join));
+		return -1;
+	}
+	g->y = 0;
+	g->x = 0;
+	vt_glyphs_init(&g->pool, mem);
+	g->sb = NULL;
+	return 0;
+}
+
+void vt_grid_fini(struct vt_grid* g) {
+	vt_free(g->mem, g->chan, vt_grid_bytes(g->rows, g->cols));
+	g->chan = NULL;
+	vt_free(g->mem, g->join, VT_JOIN_SETS * 2 * sizeof(*g->join));
+	g->join = NULL;
+	vt_glyphs_fini(&g->pool);
+}
+
+// Drops the clusters the screen doesn't use. Returns -1 if out of memory, nothing changes then.
+static int vt_grid_sweep(struct vt_grid* g) {
+	if (vt_glyphs_sweep(&g->pool, g->glyph, (size_t) g->rows * g->cols) < 0) return -1;
+	memset(g->join, 0, VT_JOIN_SETS * 2 * sizeof(*g->join));	// Ids changed
+	return 0;
+}
+
+void vt_grid_touch_all(struct vt_grid* g) {
+	memset(g->dirty, 0xFF, (g->rows + 63) / 64 * sizeof(uint64_t));
+}
+
+int vt_grid_resize(struct vt_grid* g, int rows, int cols) {
+	struct vt_grid old = *g;
+	if (vt_grid_alloc(g, rows, cols) < 0) {
+		*g = old;
+		return -1;
+	}
+	int r = rows < old.rows ? rows : old.rows;
+	int c = cols < old.cols ? cols : old.cols;
+	for (int y = 0; y < r; y++) {	// Rows come out in screen order
+		size_t from = vt_grid_at(&old, y);
+		memcpy(g->glyph + (size_t) y * cols, old.glyph + from, c * sizeof(uint32_t));
+		memcpy(g->chan + (size_t) y * cols, old.chan + from, c * sizeof(uint64_t));
+		memcpy(g->attr + (size_t) y * cols, old.attr + from, c * sizeof(uint16_t));
+	}
+	if (g->y >= rows) g->y = rows - 1;
+	if (g->x > cols) g->x = cols;
+	vt_free(g->mem, old.chan, vt_grid_bytes(old.rows, old.cols));	// The pool stays
+	vt_grid_sweep(g);
+	vt_grid_touch_all(g);
+	return 0;
+}
+
+// -------------------- ERASING
+// Erased cells are blank, without styles, and keep only the background of chan. Each erase is a fill
+// of one span per array: a row is contiguous in storage, and so is the whole screen, whatever the row order.
+
+static void vt_grid_fill(struct vt_grid* g, size_t i, size_t n, uint64_t chan) {
+	memset(g->glyph + i, 0, n * sizeof(uint32_t));
+	memset(g->attr + i, 0, n * sizeof(uint16_t));
+	if (chan == 0) memset(g->chan + i, 0, n * sizeof(uint64_t));
+	else for (size_t k = 0; k < n; k++) g->chan[i + k] = chan;
+}
+
+void vt_grid_erase(struct vt_grid* g, int y, int x0, int x1, uint64_t chan) {
+	if (x0 < 0) x0 = 0;
+	if (x1 > g->cols) x1 = g->cols;
+	if (y < 0 || y >= g->rows || x0 >= x1) return;
+	vt_grid_fill(g, vt_grid_at(g, y) + x0, x1 - x0, chan);
+	vt_grid_touch(g, y);
+}
+
+void vt_grid_erase_rows(struct vt_grid* g, int y0, int y1, uint64_t chan) {
+	if (y0 < 0) y0 = 0;
+	if (y1 > g->rows) y1 = g->rows;
+	if (y0 == 0 && y1 == g->rows) {
+		vt_grid_fill(g, 0, (size_t) g->rows * g->cols, chan);
+		vt_grid_touch_all(g);
+		return;
+	}
+	for (int y = y0; y < y1; y++) {
+		vt_grid_fill(g, vt_grid_at(g, y), g->cols, chan);
+		vt_grid_touch(g, y);
+	}
+}
+
+void vt_grid_clear(struct vt_grid* g) {
+	vt_grid_erase_rows(g, 0, g->rows, 0);
+	g->top = 0;
+	g->bot = g->rows - 1;
+}
+
+void vt_grid_goto(struct vt_grid* g, int y, int x) {
+	g->y = y < 0 ? 0 : y < g->rows ? y : g->rows - 1;
+	g->x = x < 0 ? 0 : x < g->cols ? x : g->cols - 1;
+}
+
+// -------------------- SCROLLING
+// Cells never move, screen rows get different storage rows instead: a scroll by n
+// is a rotation of row[top..bot] by n, then n storage rows are blanked.
+
+static void vt_reverse(int* a, int n) {
+	for (int i = 0, j = n - 1; i < j; i++, j--) {
+		int t = a[i];
+		a[i] = a[j];
+		a[j] = t;
+	}
+}
+
+// Rotates a[0..n) left by k
+static void vt_rotate(int* a, int n, int k) {
+	vt_reverse(a, k);
+	vt_reverse(a + k, n - k);
+	vt_reverse(a, n);
+}
+
+static void vt_grid_blank(struct vt_grid* g, int y) {
+	vt_grid_fill(g, vt_grid_at(g, y), g->cols, 0);
+}
+
+static void vt_grid_touch_region(struct vt_grid* g) {
+	for (int y = g->top; y <= g->bot; y++) vt_grid_touch(g, y);
+}
+
+void vt_grid_scroll(struct vt_grid* g, int n) {
+	int h = g->bot - g->top + 1;
+
+	if (n <= 0) return;
+	if (n > h) n = h;
+	if (g->sb && g->top == 0) {
+		for (int y = 0; y < n; y++) {
+			size_t i = vt_grid_at(g, y);
+			vt_sb_push(g->sb, g->glyph + i, g->chan + i, g->attr + i, g->cols, &g->pool);
+		}
+	}
+	if (n < h) vt_rotate(g->row + g->top, h, n);
+	for (int y = g->bot - n + 1; y <= g->bot; y++) vt_grid_blank(g, y);
+	vt_grid_touch_region(g);
+}
+
+void vt_grid_scroll_down(struct vt_grid* g, int n) {
+	int h = g->bot - g->top + 1;
+
+	if (n <= 0) return;
+	if (n > h) n = h;
+	if (n < h) vt_rotate(g->row + g->top, h, h - n);
+	for (int y = g->top; y < g->top + n; y++) vt_grid_blank(g, y);
+	vt_grid_touch_region(g);
+}
+
+void vt_grid_margins(struct vt_grid* g, int top, int bot) {
+	if (top < 0 || bot >= g->rows || top >= bot) return;
+	g->top = top;
+	g->bot = bot;
+}
+
+// Scrolls at the bottom margin only. Below it the cursor goes down to the last row and stays there.
+void vt_grid_index(struct vt_grid* g) {
+	if (g->x >= g->cols) g->x = g->cols - 1;
+	if (g->y == g->bot) vt_grid_scroll(g, 1);
+	else if (g->y + 1 < g->rows) g->y++;
+}
+
+void vt_grid_newline(struct vt_grid* g) {
+	vt_grid_index(g);
+	g->x = 0;
+}
+
+// One glyph of width w (1 or 2) at the cursor
+static inline void vt_grid_put(struct vt_grid* g, uint32_t cp, int w, uint64_t chan, uint16_t attr) {
+	if (g->x + w > g->cols) {
+		vt_grid_newline(g);
+		if (w > g->cols) return;
+	}
+	size_t i = vt_grid_at(g, g->y) + g->x;
+	g->glyph[i] = cp;
+	g->chan[i] = chan;
+	g->attr[i] = w == 2 ? attr | VT_ATTR_WIDE : attr;
+	if (w == 2) {
+		g->glyph[i + 1] = VT_GLYPH_TAIL;
+		g->chan[i + 1] = chan;
+		g->attr[i + 1] = attr;
+	}
+	g->x += w;
+	vt_grid_touch(g, g->y);
+}
+
+// UTF-8 of whatever is in a cell, up to VT_GLYPH_MAXLEN bytes
+static inline size_t vt_grid_egc(const struct vt_grid* g, uint32_t glyph, char* o) {
+	size_t len;
+	if (!vt_glyph_pooled(glyph)) return vt_u8enc(glyph, o);
+	const char* s = vt_glyphs_get(&g->pool, glyph, &len);
+	memcpy(o, s, len);
+	return len;
+}
+
+// Interns a cluster, making room in the pool if needed. Returns 0 if it can't be done.
+static uint32_t vt_grid_intern(struct vt_grid* g, const char* s, size_t len) {
+	uint32_t id = vt_glyphs_intern(&g->pool, s, len);
+	if (id) return id;
+	if (vt_grid_sweep(g) < 0) return 0;
+	return vt_glyphs_intern(&g->pool, s, len);
+}
+
+// -------------------- GRAPHEME CLUSTERS
+// A codepoint that continues the cluster left of the cursor (UAX #29) goes into that cell, so clusters
+// come out the same however the text is split. A cluster is as wide as its first codepoint, unless
+// VS16 or a second regional indicator makes it an emoji, two cells.
+// Whatever a glyph and the codepoint after it make is worked out once, and then found in g->join.
+
+static inline struct vt_join* vt_join_set(const struct vt_grid* g, uint32_t glyph, uint32_t cp) {
+	uint32_t h = (glyph * 0x9E3779B1u ^ cp) * 0x85EBCA6Bu;
+	return g->join + (size_t) (h >> 24) % VT_JOIN_SETS * 2;
+}
+
+static inline int vt_join_widens(uint32_t cp, int cls, uint8_t st) {
+	return cp == VT_WIDTH_VS16 || (cls == VT_GC_RI && st & VT_GC_RI_ODD);
+}
+
+// Returns 0 if the pool is full. j->id is 0 then, and the result mustn't be kept.
+static int vt_join_make(struct vt_grid* g, uint32_t glyph, uint32_t cp, struct vt_join* j) {
+	char egc[VT_GLYPH_MAXLEN + 4];
+	size_t len = vt_grid_egc(g, glyph, egc);
+	uint8_t st = 0;
+	int w = -1;
+	uint32_t c;
+
+	j->glyph = glyph;
+	j->cp = cp;
+	j->id = 0;
+	j->width = 0;
+	for (size_t k = 0; k < len; ) {
+		k += vt_u8dec((const unsigned char*) egc + k, len - k, &c);
+		uint8_t p = vt_width_props(c);
+		if (w < 0) w = vt_props_width(p);
+		if (vt_join_widens(c, vt_props_class(p), st)) w = 2;
+		st = vt_gc_next(st, vt_props_class(p));
+	}
+	int cls = vt_props_class(vt_width_props(cp));
+	if (!vt_gc_joins(st, cls)) return 1;
+	len += vt_u8enc(cp, egc + len);
+	if (len > VT_GLYPH_MAXLEN) {	// The glyph stays, cp is lost
+		j->id = glyph;
+		return 1;
+	}
+	j->id = vt_grid_intern(g, egc, len);
+	if (j->id == 0) return 0;	// cp is lost. glyph may have been renumbered by a sweep, the cell stays as it is.
+	if (vt_join_widens(cp, cls, st)) w = 2;
+	j->width = w > 0 ? w : 1;
+	return 1;
+}
+
+// Puts cp into the cluster left of the cursor, if it belongs there. Returns 1 if it did.
+static int vt_grid_join(struct vt_grid* g, uint32_t cp, uint8_t props) {
+	int x = g->x - 1;
+	struct vt_join j;
+
+	if (vt_props_class(props) == VT_GC_OTHER || x < 0) return 0;
+	size_t i = vt_grid_at(g, g->y) + x;
+	if (g->glyph[i] == VT_GLYPH_TAIL && x > 0) i--;
+	uint32_t glyph = g->glyph[i];
+	if (glyph == VT_GLYPH_BLANK || glyph == VT_GLYPH_TAIL) return 0;
+	if (!vt_glyph_pooled(glyph)) {	// A single codepoint, no need to look it up
+		uint8_t st = vt_gc_next(0, vt_props_class(vt_width_props(glyph)));
+		if (!vt_gc_joins(st, vt_props_class(props))) return 0;
+	}
+
+	struct vt_join* set = vt_join_set(g, glyph, cp);
+	if (set[0].glyph == glyph && set[0].cp == cp) j = set[0];
+	else if (set[1].glyph == glyph && set[1].cp == cp) {
+		j = set[1];
+		set[1] = set[0];
+		set[0] = j;
+	}
+	else if (vt_join_make(g, glyph, cp, &j) && g->glyph[i] == glyph) {	// Unless a sweep renumbered it
+		set = vt_join_set(g, glyph, cp);
+		set[1] = set[0];
+		set[0] = j;
+	}
+	if (j.id == 0) return 0;
+
+	g->glyph[i] = j.id;
+	if (j.width == 2 && !(g->attr[i] & VT_ATTR_WIDE) && x == g->x - 1 && g->x < g->cols) {
+		g->attr[i] |= VT_ATTR_WIDE;	// Room to grow into, the cursor was right after it
+		g->glyph[i + 1] = VT_GLYPH_TAIL;
+		g->chan[i + 1] = g->chan[i];
+		g->attr[i + 1] = g->attr[i] & ~VT_ATTR_WIDE;
+		g->x++;
+	}
+	vt_grid_touch(g, g->y);
+	return 1;
+}
+
+// Non-ASCII text is validated ahead in long stretches (vt_scan_utf8), and decoded without checks up to
+// where that stopped. Only bytes past that point go through the checking decoder, one codepoint at a time.
+void vt_grid_print(struct vt_grid* g, const char* s, size_t len, uint64_t chan, uint16_t attr) {
+	const unsigned char* u = (const unsigned char*) s;
+	size_t i = 0, valid = 0;	// u[i..valid) is known to be valid UTF-8
+	uint32_t cp;
+
+	while (i < len) {
+		if (u[i] < 0x80) {	// ASCII runs go straight in, as much as fits in the row
+			if (g->x >= g->cols) vt_grid_newline(g);
+			size_t at = vt_grid_at(g, g->y) + g->x;
+			size_t n = g->cols - g->x;
+			size_t k = 0;
+			while (k < n && i + k < len && u[i + k] < 0x80) {
+				g->glyph[at + k] = u[i + k];
+				g->chan[at + k] = chan;
+				g->attr[at + k] = attr;
+				k++;
+			}
+			g->x += k;
+			i += k;
+			vt_grid_touch(g, g->y);
+			continue;
+		}
+		if (i >= valid) valid = i + vt_scan_utf8(s + i, len - i);
+		if (i < valid) i += vt_u8dec_valid(u + i, &cp);
+		else i += vt_u8dec(u + i, len - i, &cp);
+		uint8_t p = vt_width_props(cp);
+		if (vt_grid_join(g, cp, p)) continue;
+		if (vt_props_width(p)) vt_grid_put(g, cp, vt_props_width(p), chan, attr);	// Zero width, nothing to join - dropped
+	}
+}
+
+void vt_grid_load(struct vt_grid* g, struct ncplane* n) {
+	uint16_t styles;
+	uint64_t chan;
+	uint32_t cp;
+	unsigned cy, cx;
+
+	for (int y = 0; y < g->rows; y++) {
+		for (int x = 0; x < g->cols; x++) {
+			char* egc = ncplane_at_yx(n, y, x, &styles, &chan);
+			if (egc == NULL) continue;
+			size_t i = vt_grid_at(g, y) + x;
+			size_t len = strlen(egc);
+			if (len) {
+				if (vt_u8dec((const unsigned char*) egc, len, &cp) == len) g->glyph[i] = cp;
+				else g->glyph[i] = vt_grid_intern(g, egc, len > VT_GLYPH_MAXLEN ? VT_GLYPH_MAXLEN : len);
+			}
+			g->chan[i] = chan;
+			g->attr[i] = styles;
+			free(egc);
+		}
+	}
+	ncplane_cursor_yx(n, &cy, &cx);	// Clamped, the plane may be bigger than the grid
+	g->y = cy < (unsigned) g->rows ? (int) cy : g->rows - 1;
+	g->x = cx < (unsigned) g->cols ? (int) cx : g->cols - 1;
+}
+
+// -------------------- BLIT
+// Each dirty row goes out as runs of cells sharing colors and styles, one ncplane_putnstr_yx per run.
+
+static int vt_grid_blit_row(struct vt_grid* g, struct ncplane* n, int y) {
+	char* buf = g->line;
+	size_t row = vt_grid_at(g, y);
+	int x = 0;
+
+	while (x < g->cols) {
+		uint64_t chan = g->chan[row + x];
+		uint16_t attr = g->attr[row + x] & ~VT_ATTR_WIDE;
+		int start = x;
+		size_t len = 0;
+
+		for (; x < g->cols; x++) {
+			size_t i = row + x;
+			if (g->chan[i] != chan || (g->attr[i] & ~VT_ATTR_WIDE) != attr) break;
+			uint32_t cp = g->glyph[i];
+			if (cp == VT_GLYPH_TAIL) {	// Covered by the wide glyph before it, unless that one is gone
+				if (x > 0 && g->attr[i - 1] & VT_ATTR_WIDE && g->glyph[i - 1] != VT_GLYPH_TAIL) continue;
+				cp = ' ';
+			}
+			else if (cp == VT_GLYPH_BLANK) cp = ' ';
+			else if (g->attr[i] & VT_ATTR_WIDE && (x + 1 >= g->cols || g->glyph[i + 1] != VT_GLYPH_TAIL)) cp = ' ';
+			len += vt_grid_egc(g, cp, buf + len);
+			if (vt_glyph_pooled(cp) && g->attr[i] & VT_ATTR_WIDE) {	// The plane may size the cluster otherwise,
+				x += 2;						// what follows goes where the grid has it
+				break;
+			}
+		}
+		if (ncplane_channels(n) != chan) ncplane_set_channels(n, chan);
+		if (ncplane_styles(n) != attr) ncplane_set_styles(n, attr);
+		if (ncplane_putnstr_yx(n, y, start, len, buf) < 0) return -1;
+	}
+	return 0;
+}
+
+int vt_grid_blit(struct vt_grid* g, struct ncplane* n) {
+	int words = (g->rows + 63) / 64;
+	int count = 0;
+
+	for (int w = 0; w < words; w++) {
+		while (g->dirty[w]) {
+			int y = w * 64 + __builtin_ctzll(g->dirty[w]);
+			g->dirty[w] &= g->dirty[w] - 1;
+			if (y >= g->rows) continue;
+			if (vt_grid_blit_row(g, n, y) < 0) return -1;
+			count++;
+		}
+	}
+	ncplane_cursor_move_yx(n, g->y, g->x < g->cols ? g->x : g->cols - 1);
+	return count;
+}
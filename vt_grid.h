@@ -0,0 +1,106 @@
+#ifndef VT_GRID_H
+#define VT_GRID_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "vt_glyphs.h"
+#include "vt_arena.h"
+
+// Screen model of a VT, kept apart from the ncplane. The parser only changes the grid,
+// and vt_grid_blit pushes the rows that changed since the last blit to the plane.
+//
+// Cells are stored as separate arrays (glyph, colors, attributes), so scans and fills touch
+// only what they need. Screen rows map to storage rows through row[], scrolling only moves those.
+
+#define VT_GLYPH_BLANK 0		// Nothing printed, shown as a space
+#define VT_GLYPH_TAIL 0xFFFFFFFFu	// Right half of a double width glyph
+
+#define VT_ATTR_WIDE 0x8000		// Glyph takes two cells, the next one is VT_GLYPH_TAIL
+
+struct ncplane;
+struct vt_scrollback;
+
+// What a glyph and the codepoint printed after it make, so that repeated clusters cost a lookup.
+// Two way sets, the least recently used of the pair goes.
+#define VT_JOIN_SETS 256
+
+struct vt_join {
+	uint32_t glyph, cp;	// Glyph left of the cursor, codepoint printed after it. glyph 0 - unused.
+	uint32_t id;		// Glyph they make together, 0 if cp starts a cluster of its own
+	uint8_t width;		// Of that glyph, 0 if it stays as wide as it is
+};
+
+struct vt_grid {
+	int rows, cols;
+	int y, x;		// Cursor. x == cols means the next glyph wraps.
+	int top, bot;		// Scrolling region (DECSTBM), inclusive
+	int* row;		// Storage row of each screen row
+	uint32_t* glyph;	// Unicode codepoint per cell, or a cluster id from pool
+	uint64_t* chan;		// notcurses channels per cell
+	uint16_t* attr;		// notcurses styles per cell, plus VT_ATTR_*
+	uint64_t* dirty;	// A bit per row, set if the row changed since the last blit
+	char* line;		// UTF-8 of a row being blitted
+	struct vt_glyphs pool;	// Clusters that don't fit in a codepoint
+	struct vt_join* join;	// VT_JOIN_SETS * 2, cleared whenever the pool renumbers
+	struct vt_scrollback* sb;	// Rows scrolled off the top go here, may be NULL
+	struct vt_arena* mem;	// Where all of the above comes from, NULL - the heap
+};
+
+// Returns 0, or -1 if out of memory. mem is where the grid allocates, NULL for the heap.
+int vt_grid_init(struct vt_grid* g, int rows, int cols, struct vt_arena* mem);
+void vt_grid_fini(struct vt_grid* g);
+
+// Changes the size, keeping the top left part and the cursor within bounds. All rows become dirty.
+int vt_grid_resize(struct vt_grid* g, int rows, int cols);
+
+// Copies the cells and cursor of the plane, so the grid carries on from what is there already.
+void vt_grid_load(struct vt_grid* g, struct ncplane* n);
+
+// Prints len bytes of UTF-8 at the cursor, wrapping and scrolling as needed. Malformed bytes become U+FFFD.
+// len must end on a codepoint boundary: clusters go on across calls, codepoints don't.
+void vt_grid_print(struct vt_grid* g, const char* s, size_t len, uint64_t chan, uint16_t attr);
+
+// Cursor down a row in the same column (LF, IND), scrolls at the bottom. Cancels a pending wrap.
+void vt_grid_index(struct vt_grid* g);
+
+// Cursor to the start of the next line, scrolls at the bottom. This is what wrapping does.
+void vt_grid_newline(struct vt_grid* g);
+
+// Scrolls the region up by n rows, blanking n rows at the bottom. Rows leaving the top
+// of the screen go to the scrollback.
+void vt_grid_scroll(struct vt_grid* g, int n);
+
+// Scrolls the region down by n rows, blanking n rows at the top
+void vt_grid_scroll_down(struct vt_grid* g, int n);
+
+// Sets the scrolling region, rows top to bot inclusive. Invalid regions are ignored.
+void vt_grid_margins(struct vt_grid* g, int top, int bot);
+
+// Blanks cells x0..x1 (exclusive) of row y, giving them the background of chan
+void vt_grid_erase(struct vt_grid* g, int y, int x0, int x1, uint64_t chan);
+
+// Blanks rows y0..y1 (exclusive) the same way. The whole screen takes a single fill.
+void vt_grid_erase_rows(struct vt_grid* g, int y0, int y1, uint64_t chan);
+
+// Blanks the whole grid and resets the scrolling region. The cursor stays.
+void vt_grid_clear(struct vt_grid* g);
+
+// Moves the cursor to y, x, or as close as it gets on the screen. Cancels a pending wrap.
+void vt_grid_goto(struct vt_grid* g, int y, int x);
+
+// Writes the dirty rows to the plane, and puts its cursor where the grid's is.
+// Returns the number of rows written, or -1 on error.
+int vt_grid_blit(struct vt_grid* g, struct ncplane* n);
+
+// First cell of screen row y
+static inline size_t vt_grid_at(const struct vt_grid* g, int y) {
+	return (size_t) g->row[y] * g->cols;
+}
+
+static inline void vt_grid_touch(struct vt_grid* g, int y) {
+	g->dirty[y >> 6] |= 1ull << (y & 63);
+}
+
+void vt_grid_touch_all(struct vt_grid* g);
+
+#endif
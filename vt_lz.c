@@ -0,0 +1,107 @@
+#include "vt_lz.h"
+#include <stdint.h>
+#include <string.h>
+
+// A sequence is: token (literal count << 4 | match length - 4), more literal count bytes if it was 15,
+// the literals, then a 16-bit little endian offset and more match length bytes if it was 15.
+// The last sequence has literals only.
+
+#define VT_LZ_MINMATCH 4
+#define VT_LZ_HASHBITS 12
+#define VT_LZ_TAIL 5		// Bytes at the end always go as literals
+
+static inline uint32_t vt_lz_read32(const uint8_t* p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static inline uint32_t vt_lz_hash(uint32_t v) {
+	return (v * 2654435761u) >> (32 - VT_LZ_HASHBITS);
+}
+
+static inline uint8_t* vt_lz_len(uint8_t* o, size_t len) {
+	for (; len >= 255; len -= 255) *o++ = 255;
+	*o++ = len;
+	return o;
+}
+
+static uint8_t* vt_lz_sequence(uint8_t* o, const uint8_t* lit, size_t nlit, size_t off, size_t mlen) {
+	uint8_t* token = o++;
+	*token = (nlit < 15 ? nlit : 15) << 4;
+	if (nlit >= 15) o = vt_lz_len(o, nlit - 15);
+	memcpy(o, lit, nlit);
+	o += nlit;
+	if (mlen == 0) return o;
+	*o++ = off;
+	*o++ = off >> 8;
+	mlen -= VT_LZ_MINMATCH;
+	*token |= mlen < 15 ? mlen : 15;
+	if (mlen >= 15) o = vt_lz_len(o, mlen - 15);
+	return o;
+}
+
+size_t vt_lz_compress(const void* src, size_t n, void* dst) {
+	const uint8_t* s = src;
+	uint8_t* o = dst;
+	uint32_t table[1 << VT_LZ_HASHBITS];
+	size_t anchor = 0, i = 0;
+
+	memset(table, 0xFF, sizeof(table));
+	while (n > VT_LZ_TAIL && i < n - VT_LZ_TAIL) {
+		uint32_t v = vt_lz_read32(s + i);
+		uint32_t h = vt_lz_hash(v);
+		size_t cand = table[h];
+		table[h] = i;
+		if (cand == 0xFFFFFFFFu || i - cand > 0xFFFF || vt_lz_read32(s + cand) != v) {
+			i++;
+			continue;
+		}
+		size_t m = VT_LZ_MINMATCH;
+		while (i + m < n - VT_LZ_TAIL && s[cand + m] == s[i + m]) m++;
+		o = vt_lz_sequence(o, s + anchor, i - anchor, i - cand, m);
+		i += m;
+		anchor = i;
+	}
+	o = vt_lz_sequence(o, s + anchor, n - anchor, 0, 0);
+	return o - (uint8_t*) dst;
+}
+
+// Reads an extended length, returns -1 if it runs past the end
+static inline long vt_lz_getlen(const uint8_t** p, const uint8_t* end, size_t len) {
+	uint8_t b;
+	do {
+		if (*p >= end) return -1;
+		b = *(*p)++;
+		len += b;
+	} while (b == 255);
+	return len;
+}
+
+long vt_lz_decompress(const void* src, size_t n, void* dst, size_t cap) {
+	const uint8_t* p = src;
+	const uint8_t* end = p + n;
+	uint8_t* o = dst;
+	size_t pos = 0;
+
+	while (p < end) {
+		uint8_t token = *p++;
+		long nlit = token >> 4;
+		if (nlit == 15 && (nlit = vt_lz_getlen(&p, end, 15)) < 0) return -1;
+		if ((size_t) nlit > (size_t) (end - p) || (size_t) nlit > cap - pos) return -1;
+		memcpy(o + pos, p, nlit);
+		p += nlit;
+		pos += nlit;
+		if (p == end) break;	// Last sequence
+
+		if (end - p < 2) return -1;
+		size_t off = p[0] | p[1] << 8;
+		p += 2;
+		long mlen = token & 15;
+		if (mlen == 15 && (mlen = vt_lz_getlen(&p, end, 15)) < 0) return -1;
+		mlen += VT_LZ_MINMATCH;
+		if (off == 0 || off > pos || (size_t) mlen > cap - pos) return -1;
+		for (long k = 0; k < mlen; k++, pos++) o[pos] = o[pos - off];	// May overlap, bytewise on purpose
+	}
+	return pos;
+}
@@ -0,0 +1,19 @@
+#ifndef VT_LZ_H
+#define VT_LZ_H
+
+#include <stddef.h>
+
+// Small LZ77 codec in the spirit of LZ4: byte aligned, no entropy coding, 64 KB window.
+// Fast enough to compress scrollback as it goes by, and to decompress it whenever it's looked at.
+
+// Worst case compressed size of n bytes
+#define VT_LZ_BOUND(n) ((n) + (n) / 255 + 16)
+
+// Compresses n bytes of src into dst, which must hold VT_LZ_BOUND(n) bytes. Returns the compressed size.
+size_t vt_lz_compress(const void* src, size_t n, void* dst);
+
+// Decompresses n bytes of src into dst of cap bytes.
+// Returns the decompressed size, or -1 if src is malformed or doesn't fit.
+long vt_lz_decompress(const void* src, size_t n, void* dst, size_t cap);
+
+#endif
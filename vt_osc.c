@@ -0,0 +1,44 @@
+#include "vt_osc.h"
+#include <stdint.h>
+
+int vt_osc_finish(struct vt_osc* o, char** arg) {
+	int cmd = 0;
+	size_t i = 0;
+
+	if (o->drop) return -1;
+	o->buf[o->len] = 0;
+	for (; i < o->len && o->buf[i] >= '0' && o->buf[i] <= '9'; i++) {
+		if (cmd < 10000) cmd = cmd * 10 + (o->buf[i] - '0');
+	}
+	if (i == 0 || (i < o->len && o->buf[i] != ';')) return -1;
+	*arg = o->buf + (i < o->len ? i + 1 : i);
+	return cmd;
+}
+
+static inline int vt_b64(unsigned char c) {
+	if (c >= 'A' && c <= 'Z') return c - 'A';
+	if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+	if (c >= '0' && c <= '9') return c - '0' + 52;
+	if (c == '+') return 62;
+	if (c == '/') return 63;
+	return -1;
+}
+
+long vt_base64_decode(char* s) {
+	const unsigned char* u = (const unsigned char*) s;
+	uint32_t acc = 0;
+	int bits = 0;
+	long n = 0;
+
+	for (; *u && *u != '='; u++) {
+		int v = vt_b64(*u);
+		if (v < 0) return -1;
+		acc = acc << 6 | v;
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			s[n++] = acc >> bits;	// Output never catches up with input, 3 bytes per 4
+		}
+	}
+	return n;
+}
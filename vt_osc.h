@@ -0,0 +1,42 @@
+#ifndef VT_OSC_H
+#define VT_OSC_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+// OSC payloads, collected as the parser hands them over in pieces. The buffer is fixed, nothing is allocated:
+// a payload that doesn't fit is dropped whole, and the rest of it is skipped without being copied anywhere.
+// "OSC Ps ; Pt ST" - Ps is the command number, Pt its argument.
+
+#define VT_OSC_MAX (16 * 1024)	// Longest payload kept, enough for a few KB of OSC 52 clipboard
+
+struct vt_osc {
+	size_t len;
+	bool drop;		// Too long or cancelled, ignored when it ends
+	char buf[VT_OSC_MAX + 1];	// Room for a terminating 0
+};
+
+static inline void vt_osc_reset(struct vt_osc* o) {
+	o->len = 0;
+	o->drop = false;
+}
+
+static inline void vt_osc_add(struct vt_osc* o, const char* s, size_t len) {
+	if (o->drop) return;
+	if (len > VT_OSC_MAX - o->len) {
+		o->drop = true;
+		return;
+	}
+	memcpy(o->buf + o->len, s, len);
+	o->len += len;
+}
+
+// Finishes the payload. Returns the command number with *arg pointing to the 0 terminated argument,
+// or -1 if the payload was dropped or doesn't start with a number.
+int vt_osc_finish(struct vt_osc* o, char** arg);
+
+// Decodes base64 in s in place, stopping at the first '=' or 0. Returns the decoded length, or -1 if it's not base64.
+long vt_base64_decode(char* s);
+
+#endif
@@ -0,0 +1,49 @@
+#include "vt_pace.h"
+#include "notcurses/notcurses.h"
+#include <time.h>
+
+static uint64_t vt_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int vt_pacer_render(struct vt_pacer* p, uint64_t now) {
+	p->last = now;
+	p->dirty = p->prerender && p->prerender(p->opaque) > 0;
+	p->frames++;
+	return notcurses_render(p->nc);
+}
+
+void vt_pacer_init(struct vt_pacer* p, struct notcurses* nc, unsigned max_fps) {
+	p->nc = nc;
+	p->frame_ns = max_fps ? 1000000000ull / max_fps : 0;
+	p->last = 0;
+	p->dirty = false;
+	p->bytes = 0;
+	p->frames = 0;
+	p->prerender = NULL;
+	p->opaque = NULL;
+}
+
+int vt_pacer_fed(struct vt_pacer* p, size_t len) {
+	p->bytes += len;
+	p->dirty = true;
+	if (!p->frame_ns) return 0;
+	uint64_t now = vt_now();
+	if (now - p->last < p->frame_ns) return 0;
+	return vt_pacer_render(p, now);
+}
+
+int vt_pacer_idle(struct vt_pacer* p) {
+	if (!p->dirty) return 0;
+	return vt_pacer_render(p, vt_now());
+}
+
+int vt_pacer_timeout(const struct vt_pacer* p) {
+	if (!p->dirty) return -1;
+	if (!p->frame_ns) return 0;	// Render as soon as the input stops
+	uint64_t since = vt_now() - p->last;
+	if (since >= p->frame_ns) return 0;
+	return (p->frame_ns - since + 999999) / 1000000;
+}
@@ -0,0 +1,47 @@
+#ifndef VT_PACE_H
+#define VT_PACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Frame pacing: input is parsed as soon as it arrives, but notcurses_render is called
+// at most max_fps times per second, plus once whenever the input goes quiet.
+//
+// Typical loop:
+//	vt_pacer_init(&p, nc, 60);
+//	while (poll(fds, 1, vt_pacer_timeout(&p)) >= 0) {
+//		if nothing to read: vt_pacer_idle(&p); continue;
+//		s = read(...); ncplane_putvt(...); vt_pacer_fed(&p, s);
+//	}
+
+struct notcurses;
+
+struct vt_pacer {
+	struct notcurses* nc;
+	uint64_t frame_ns;	// Minimal time between renders, 0 - render on idle only
+	uint64_t last;		// Time of the last render (CLOCK_MONOTONIC, ns)
+	bool dirty;		// Something was parsed since the last render
+	uint64_t bytes;		// Bytes parsed so far
+	uint64_t frames;	// Frames rendered so far
+	// Called right before each render, may be NULL. Returning 1 means more output is on its way
+	// (e.g. still being parsed on another thread), so another frame will follow even without new input.
+	int (*prerender)(void* opaque);
+	void* opaque;
+};
+
+// Clears the prerender hook as well, set it afterwards if needed.
+void vt_pacer_init(struct vt_pacer* p, struct notcurses* nc, unsigned max_fps);
+
+// Call after feeding len bytes to ncplane_putvt. Renders if a frame is due.
+// Returns the notcurses_render result, or 0 if nothing was rendered.
+int vt_pacer_fed(struct vt_pacer* p, size_t len);
+
+// Call when no input is waiting. Renders if anything changed since the last frame.
+int vt_pacer_idle(struct vt_pacer* p);
+
+// Milliseconds to wait for input before calling vt_pacer_idle, ready for poll().
+// -1 (forever) if there's nothing to render.
+int vt_pacer_timeout(const struct vt_pacer* p);
+
+#endif
@@ -0,0 +1,388 @@
+#include "vt_parser.h"
+#include "vt_scan.h"
+#include "vt_utf8.h"
+
+// Byte classes
+enum {
+	C_C0,	// C0 controls, except the ones below
+	C_BEL,	// 0x07, also terminates OSC
+	C_CAN,	// CAN, SUB - abort any sequence
+	C_ESC,
+	C_INT,	// 0x20-0x2F, intermediate bytes
+	C_DIG,	// 0x30-0x39
+	C_COL,	// ':'
+	C_SEM,	// ';'
+	C_PRV,	// 0x3C-0x3F, private markers
+	C_DCS,	// 'P'
+	C_SOS,	// 'X', '^', '_' (SOS, PM, APC)
+	C_CSI,	// '['
+	C_ST,	// '\\'
+	C_OSC,	// ']'
+	C_FIN,	// Any other 0x40-0x7E
+	C_DEL,	// 0x7F
+	C_HI,	// 0x80-0xFF, UTF-8
+	C_NCLASSES
+};
+
+#define R4(c) c, c, c, c
+#define R8(c) R4(c), R4(c)
+#define R16(c) R8(c), R8(c)
+
+static const uint8_t vt_class[256] = {
+	R4(C_C0), C_C0, C_C0, C_C0, C_BEL, R8(C_C0),			// 0x00
+	R8(C_C0), C_CAN, C_C0, C_CAN, C_ESC, R4(C_C0),			// 0x10
+	R16(C_INT),							// 0x20
+	R8(C_DIG), C_DIG, C_DIG, C_COL, C_SEM, R4(C_PRV),		// 0x30
+	R16(C_FIN),							// 0x40
+	C_DCS, R4(C_FIN), C_FIN, C_FIN, C_FIN,				// 0x50
+	C_SOS, C_FIN, C_FIN, C_CSI, C_ST, C_OSC, C_SOS, C_SOS,
+	R16(C_FIN),							// 0x60
+	R8(C_FIN), R4(C_FIN), C_FIN, C_FIN, C_FIN, C_DEL,		// 0x70
+	R16(C_HI), R16(C_HI), R16(C_HI), R16(C_HI),			// 0x80-0xFF
+	R16(C_HI), R16(C_HI), R16(C_HI), R16(C_HI),
+};
+
+// Actions
+enum {
+	A_NONE,
+	A_EXECUTE,
+	A_COLLECT,	// Private marker or intermediate byte
+	A_PARAM,
+	A_ESC_DISPATCH,
+	A_CSI_DISPATCH,
+	A_DCS_FINAL,	// Final byte of DCS, hook follows
+	A_DCS_PUT,
+	A_OSC_PUT,
+	A_REDO,		// Abort the sequence and parse the byte again in ground state
+};
+
+// Transition table: action in the high nibble, next state in the low one.
+// Entering ESCAPE, CSI_ENTRY and DCS_ENTRY clears the sequence, entering and leaving OSC_STRING and DCS_PASS
+// calls osc_start/osc_end and dcs_hook/dcs_unhook - see vt_transition().
+#define T(a, s) (A_##a << 4 | VT_##s)
+
+static const uint8_t vt_trans[VT_NSTATES][C_NCLASSES] = {
+	//	C0	BEL	CAN	ESC	INT	DIG	COL	SEM	PRV	DCS	SOS	CSI	ST	OSC	FIN	DEL	HI
+	[VT_GROUND] = {
+		T(EXECUTE, GROUND), T(EXECUTE, GROUND), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND),
+		T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND),
+		T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND),
+		T(NONE, GROUND),
+	},
+	[VT_ESCAPE] = {
+		T(EXECUTE, ESCAPE), T(EXECUTE, ESCAPE), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(COLLECT, ESCAPE_INTER), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND),
+		T(ESC_DISPATCH, GROUND), T(NONE, DCS_ENTRY), T(NONE, SOS_STRING), T(NONE, CSI_ENTRY),
+		T(ESC_DISPATCH, GROUND), T(NONE, OSC_STRING), T(ESC_DISPATCH, GROUND), T(NONE, ESCAPE),
+		T(REDO, GROUND),
+	},
+	[VT_ESCAPE_INTER] = {
+		T(EXECUTE, ESCAPE_INTER), T(EXECUTE, ESCAPE_INTER), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(COLLECT, ESCAPE_INTER), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND),
+		T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND),
+		T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(ESC_DISPATCH, GROUND), T(NONE, ESCAPE_INTER),
+		T(REDO, GROUND),
+	},
+	[VT_CSI_ENTRY] = {
+		T(EXECUTE, CSI_ENTRY), T(EXECUTE, CSI_ENTRY), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(COLLECT, CSI_INTER), T(PARAM, CSI_PARAM), T(PARAM, CSI_PARAM), T(PARAM, CSI_PARAM),
+		T(COLLECT, CSI_PARAM), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND),
+		T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(NONE, CSI_ENTRY),
+		T(REDO, GROUND),
+	},
+	[VT_CSI_PARAM] = {
+		T(EXECUTE, CSI_PARAM), T(EXECUTE, CSI_PARAM), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(COLLECT, CSI_INTER), T(PARAM, CSI_PARAM), T(PARAM, CSI_PARAM), T(PARAM, CSI_PARAM),
+		T(NONE, CSI_IGNORE), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND),
+		T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(NONE, CSI_PARAM),
+		T(REDO, GROUND),
+	},
+	[VT_CSI_INTER] = {
+		T(EXECUTE, CSI_INTER), T(EXECUTE, CSI_INTER), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(COLLECT, CSI_INTER), T(NONE, CSI_IGNORE), T(NONE, CSI_IGNORE), T(NONE, CSI_IGNORE),
+		T(NONE, CSI_IGNORE), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND),
+		T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(CSI_DISPATCH, GROUND), T(NONE, CSI_INTER),
+		T(REDO, GROUND),
+	},
+	[VT_CSI_IGNORE] = {
+		T(EXECUTE, CSI_IGNORE), T(EXECUTE, CSI_IGNORE), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(NONE, CSI_IGNORE), T(NONE, CSI_IGNORE), T(NONE, CSI_IGNORE), T(NONE, CSI_IGNORE),
+		T(NONE, CSI_IGNORE), T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND),
+		T(NONE, GROUND), T(NONE, GROUND), T(NONE, GROUND), T(NONE, CSI_IGNORE),
+		T(REDO, GROUND),
+	},
+	[VT_OSC_STRING] = {
+		T(NONE, OSC_STRING), T(NONE, GROUND), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(OSC_PUT, OSC_STRING), T(OSC_PUT, OSC_STRING), T(OSC_PUT, OSC_STRING), T(OSC_PUT, OSC_STRING),
+		T(OSC_PUT, OSC_STRING), T(OSC_PUT, OSC_STRING), T(OSC_PUT, OSC_STRING), T(OSC_PUT, OSC_STRING),
+		T(OSC_PUT, OSC_STRING), T(OSC_PUT, OSC_STRING), T(OSC_PUT, OSC_STRING), T(OSC_PUT, OSC_STRING),
+		T(OSC_PUT, OSC_STRING),
+	},
+	[VT_DCS_ENTRY] = {
+		T(NONE, DCS_ENTRY), T(NONE, DCS_ENTRY), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(COLLECT, DCS_INTER), T(PARAM, DCS_PARAM), T(PARAM, DCS_PARAM), T(PARAM, DCS_PARAM),
+		T(COLLECT, DCS_PARAM), T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS),
+		T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS), T(NONE, DCS_ENTRY),
+		T(NONE, DCS_ENTRY),
+	},
+	[VT_DCS_PARAM] = {
+		T(NONE, DCS_PARAM), T(NONE, DCS_PARAM), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(COLLECT, DCS_INTER), T(PARAM, DCS_PARAM), T(PARAM, DCS_PARAM), T(PARAM, DCS_PARAM),
+		T(NONE, DCS_IGNORE), T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS),
+		T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS), T(NONE, DCS_PARAM),
+		T(NONE, DCS_PARAM),
+	},
+	[VT_DCS_INTER] = {
+		T(NONE, DCS_INTER), T(NONE, DCS_INTER), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(COLLECT, DCS_INTER), T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE),
+		T(NONE, DCS_IGNORE), T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS),
+		T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS), T(DCS_FINAL, DCS_PASS), T(NONE, DCS_INTER),
+		T(NONE, DCS_INTER),
+	},
+	[VT_DCS_PASS] = {
+		T(DCS_PUT, DCS_PASS), T(DCS_PUT, DCS_PASS), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(DCS_PUT, DCS_PASS), T(DCS_PUT, DCS_PASS), T(DCS_PUT, DCS_PASS), T(DCS_PUT, DCS_PASS),
+		T(DCS_PUT, DCS_PASS), T(DCS_PUT, DCS_PASS), T(DCS_PUT, DCS_PASS), T(DCS_PUT, DCS_PASS),
+		T(DCS_PUT, DCS_PASS), T(DCS_PUT, DCS_PASS), T(DCS_PUT, DCS_PASS), T(NONE, DCS_PASS),
+		T(DCS_PUT, DCS_PASS),
+	},
+	[VT_DCS_IGNORE] = {
+		T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE),
+		T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE),
+		T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE), T(NONE, DCS_IGNORE),
+		T(NONE, DCS_IGNORE),
+	},
+	[VT_SOS_STRING] = {
+		T(NONE, SOS_STRING), T(NONE, SOS_STRING), T(EXECUTE, GROUND), T(NONE, ESCAPE),
+		T(NONE, SOS_STRING), T(NONE, SOS_STRING), T(NONE, SOS_STRING), T(NONE, SOS_STRING),
+		T(NONE, SOS_STRING), T(NONE, SOS_STRING), T(NONE, SOS_STRING), T(NONE, SOS_STRING),
+		T(NONE, SOS_STRING), T(NONE, SOS_STRING), T(NONE, SOS_STRING), T(NONE, SOS_STRING),
+		T(NONE, SOS_STRING),
+	},
+};
+
+void vt_parser_init(struct vt_parser* ps, const struct vt_parser_cb* cb, void* opaque) {
+	ps->cb = cb;
+	ps->opaque = opaque;
+	ps->state = VT_GROUND;
+	ps->u8n = 0;
+	ps->u8len = 0;
+	ps->seq.n = 0;
+}
+
+static inline void vt_clear(struct vt_csi* seq) {
+	// Parameters are initialized as they come, no need to clear them
+	seq->sub = 0;
+	seq->n = 0;
+	seq->ninter = 0;
+	seq->priv = 0;
+	seq->final = 0;
+}
+
+// Exit action of the current state, entry action of the next one
+static int vt_transition(struct vt_parser* ps, unsigned next) {
+	const struct vt_parser_cb* cb = ps->cb;
+	int r = 0;
+
+	switch (ps->state) {
+		case VT_OSC_STRING: if (cb->osc_end) r = cb->osc_end(ps->opaque); break;
+		case VT_DCS_PASS: if (cb->dcs_unhook) r = cb->dcs_unhook(ps->opaque); break;
+	}
+	ps->state = next;
+	if (r < 0) return r;
+
+	switch (next) {
+		case VT_ESCAPE:
+		case VT_CSI_ENTRY:
+		case VT_DCS_ENTRY: vt_clear(&ps->seq); break;
+		case VT_OSC_STRING: if (cb->osc_start) r = cb->osc_start(ps->opaque); break;
+		case VT_DCS_PASS: if (cb->dcs_hook) r = cb->dcs_hook(ps->opaque, &ps->seq); break;
+	}
+	return r;
+}
+
+// Parameter bytes - digits, ';' and ':' - are all eaten in a tight loop, with the current parameter kept
+// in a register. Returns position past the consumed bytes.
+static size_t vt_param(struct vt_csi* seq, const unsigned char* u, size_t len, size_t i) {
+	unsigned n = seq->n;		// Parameters started so far, VT_CSI_MAXPARAM + 1 means overflow
+	unsigned x;
+	unsigned b;
+
+	if (n == 0) {			// "ESC [ ; 5" has an empty first param
+		seq->param[0] = VT_CSI_NONE;
+		n = 1;
+	}
+	x = seq->param[n - 1];
+	do {
+		b = u[i];
+		if (b - '0' < 10) {
+			x = (x == VT_CSI_NONE ? 0 : x) * 10 + (b - '0');
+			if (x > VT_CSI_PMAX) x = VT_CSI_PMAX;
+		}
+		else if (b == ';' || b == ':') {
+			seq->param[n - 1] = x;
+			x = VT_CSI_NONE;
+			if (n <= VT_CSI_MAXPARAM) {
+				if (b == ':' && n < VT_CSI_MAXPARAM) seq->sub |= 1 << n;
+				n++;
+			}
+		}
+		else break;
+	} while (++i < len);
+	seq->param[n - 1] = x;
+	seq->n = n;
+	return i;
+}
+
+static inline void vt_collect(struct vt_csi* seq, unsigned char b) {
+	if (b >= 0x3C) seq->priv = b;
+	else if (seq->ninter < VT_CSI_MAXINTER) seq->inter[seq->ninter++] = b;
+}
+
+static inline void vt_final(struct vt_csi* seq, unsigned char b) {
+	if (seq->n > VT_CSI_MAXPARAM) seq->n = VT_CSI_MAXPARAM;
+	seq->final = b;
+}
+
+// Length of the UTF-8 codepoint at u[i], if it's complete and valid.
+// 0 if the buffer ends before it's complete. Malformed ones are 1 byte long, the grid makes U+FFFD of them.
+static inline size_t vt_u8len(const unsigned char* u, size_t len, size_t i) {
+	size_t l = vt_u8need(u[i]);
+	for (size_t k = 1; k < l; k++) {
+		if (i + k >= len) return 0;
+		if (k == 1 ? !vt_u8second(u[i], u[i + 1]) : (u[i + k] & 0xC0) != 0x80) return 1;
+	}
+	return l;
+}
+
+// Ground state: printable ASCII and UTF-8 is gathered into one span, up to the next control byte.
+// A codepoint cut by the end of buffer is stashed for later.
+static int vt_ground(struct vt_parser* ps, const unsigned char* u, size_t len, size_t* pi) {
+	size_t start = *pi, i = *pi, l;
+
+	for (;;) {
+		if (i < len && u[i] >= 0x20 && u[i] < 0x7F) i += vt_scan_ctl((const char*) u + i, len - i);
+		if (i >= len || u[i] < 0x80) break;
+		l = vt_u8len(u, len, i);
+		if (l == 0) {
+			ps->u8len = vt_u8need(u[i]);
+			for (ps->u8n = 0; i + ps->u8n < len; ps->u8n++) ps->u8[ps->u8n] = u[i + ps->u8n];
+			*pi = len;
+			goto print;
+		}
+		i += l;
+	}
+	*pi = i;
+print:
+	if (i > start && ps->cb->print) return ps->cb->print(ps->opaque, (const char*) u + start, i - start);
+	return 0;
+}
+
+// Completes the codepoint stashed by vt_ground. If it turns out to be malformed, what's there is printed as is.
+static int vt_u8finish(struct vt_parser* ps, const unsigned char* u, size_t len, size_t* pi) {
+	size_t i = *pi;
+	while (ps->u8n < ps->u8len && i < len && (u[i] & 0xC0) == 0x80) ps->u8[ps->u8n++] = u[i++];
+	*pi = i;
+	if (ps->u8n < ps->u8len && i == len) return 0;	// Still not there
+
+	size_t n = ps->u8n;
+	ps->u8n = 0;
+	if (ps->cb->print) return ps->cb->print(ps->opaque, ps->u8, n);
+	return 0;
+}
+
+// String states take everything up to a terminator in one go.
+// Returns the end of the span starting at i.
+static inline size_t vt_string_span(unsigned state, const unsigned char* u, size_t len, size_t i) {
+	switch (state) {
+		case VT_OSC_STRING:	// Anything but C0
+			while (i < len && u[i] >= 0x20) i++;
+			break;
+		case VT_DCS_PASS:	// Anything but CAN, SUB, ESC, DEL
+			while (i < len && u[i] != 0x18 && u[i] != 0x1A && u[i] != 0x1B && u[i] != 0x7F) i++;
+			break;
+		default:		// Ignored strings, up to CAN, SUB or ESC
+			while (i < len && u[i] != 0x18 && u[i] != 0x1A && u[i] != 0x1B) i++;
+	}
+	return i;
+}
+
+int vt_parser_feed(struct vt_parser* ps, const char* p, size_t len) {
+	const unsigned char* u = (const unsigned char*) p;
+	const struct vt_parser_cb* cb = ps->cb;
+	void* op = ps->opaque;
+	size_t i = 0, e;
+	unsigned b, t, next;
+	int r = 0;
+
+	if (ps->u8n && (r = vt_u8finish(ps, u, len, &i)) < 0) return r;
+
+	while (i < len) {
+		switch (ps->state) {
+			case VT_GROUND:
+				if ((r = vt_ground(ps, u, len, &i)) < 0) return r;
+				if (i >= len) return 0;
+				break;
+			case VT_OSC_STRING:
+			case VT_DCS_PASS:
+			case VT_DCS_IGNORE:
+			case VT_SOS_STRING:
+				e = vt_string_span(ps->state, u, len, i);
+				if (e > i) {
+					if (ps->state == VT_OSC_STRING && cb->osc_put) r = cb->osc_put(op, p + i, e - i);
+					if (ps->state == VT_DCS_PASS && cb->dcs_put) r = cb->dcs_put(op, p + i, e - i);
+					if (r < 0) return r;
+					i = e;
+				}
+				if (i >= len) return 0;
+				break;
+		}
+
+		b = u[i];
+		t = vt_trans[ps->state][vt_class[b]];
+		next = t & 0x0F;
+
+		switch (t >> 4) {
+			case A_EXECUTE:
+				if (cb->execute) r = cb->execute(op, b);
+				break;
+			case A_COLLECT:
+				vt_collect(&ps->seq, b);
+				break;
+			case A_PARAM:	// May take more than one byte, so it skips the common i++ below
+				i = vt_param(&ps->seq, u, len, i);
+				ps->state = next;
+				continue;
+			case A_ESC_DISPATCH:
+				vt_final(&ps->seq, b);
+				if (cb->esc) r = cb->esc(op, &ps->seq);
+				break;
+			case A_CSI_DISPATCH:
+				vt_final(&ps->seq, b);
+				if (cb->csi) r = cb->csi(op, &ps->seq);
+				break;
+			case A_DCS_FINAL:
+				vt_final(&ps->seq, b);
+				break;
+			case A_DCS_PUT:		// C0 bytes inside DCS, the rest goes through vt_string_span
+				if (cb->dcs_put) r = cb->dcs_put(op, p + i, 1);
+				break;
+			case A_OSC_PUT:
+				if (cb->osc_put) r = cb->osc_put(op, p + i, 1);
+				break;
+			case A_REDO:
+				i--;
+				break;
+		}
+		if (r < 0) return r;
+		i++;
+
+		// ESC restarts a sequence even from the ESCAPE state itself
+		if (next != ps->state || b == 0x1B) {
+			if ((r = vt_transition(ps, next)) < 0) return r;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef VT_PARSER_H
+#define VT_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// VT escape sequence parser.
+//
+// A table driven state machine, after the DEC parser described by Paul Williams (vt100.net/emu/dec_ansi_parser),
+// extended with UTF-8 text in the ground state. Every byte is classified, and (state, class) picks an action
+// and the next state from a single table. All state lives in struct vt_parser, so input may be split between
+// any two bytes, and no byte is ever looked at twice.
+//
+// The parser only recognizes sequences - what they mean is up to the callbacks.
+//
+// CSI structure:
+// 0x1B 0x5B [private marker] [parameters] [intermediates] final
+// Parameters are unsigned integers separated by ';', or ':' for sub-parameters. Any of them may be missing.
+
+#define VT_CSI_MAXPARAM 16	// Parameters past this are ignored
+#define VT_CSI_MAXINTER 2	// Same for intermediate bytes
+#define VT_CSI_NONE 0xFFFF	// Value of a missing (default) parameter
+#define VT_CSI_PMAX 9999	// Parameter values saturate here
+
+// Collected parameters, private marker, intermediates and final byte of an ESC, CSI or DCS sequence
+struct vt_csi {
+	uint16_t param[VT_CSI_MAXPARAM + 1];	// The extra one is scratch space for ignored parameters
+	uint16_t sub;		// Bit i set means param[i] followed a ':', i.e. it's a sub-parameter of the previous one
+	uint8_t n;		// Number of parameters
+	uint8_t ninter;		// Number of intermediate bytes
+	char priv;		// Private marker ('<', '=', '>', '?'), or 0
+	char inter[VT_CSI_MAXINTER];
+	char final;		// Final byte
+};
+
+// Returns parameter i, or def if it's missing
+static inline int vt_csi_param(const struct vt_csi* c, int i, int def) {
+	if (i >= c->n || c->param[i] == VT_CSI_NONE) return def;
+	return c->param[i];
+}
+
+// Checks if parameter i is a sub-parameter (preceded by ':')
+static inline bool vt_csi_issub(const struct vt_csi* c, int i) {
+	return i < c->n && (c->sub >> i) & 1;
+}
+
+enum vt_state {
+	VT_GROUND,
+	VT_ESCAPE,
+	VT_ESCAPE_INTER,
+	VT_CSI_ENTRY,
+	VT_CSI_PARAM,
+	VT_CSI_INTER,
+	VT_CSI_IGNORE,
+	VT_OSC_STRING,
+	VT_DCS_ENTRY,
+	VT_DCS_PARAM,
+	VT_DCS_INTER,
+	VT_DCS_PASS,
+	VT_DCS_IGNORE,
+	VT_SOS_STRING,		// SOS, PM and APC strings, all ignored
+	VT_NSTATES
+};
+
+// What the parser has found. Any callback may be NULL, then the thing is ignored.
+// Callbacks return a negative value to stop the parser, which then returns that value.
+struct vt_parser_cb {
+	int (*print)(void* opaque, const char* s, size_t len);		// Printable text, whole UTF-8 codepoints
+	int (*execute)(void* opaque, unsigned char c);			// C0 control
+	int (*esc)(void* opaque, const struct vt_csi* seq);		// ESC [intermediates] final
+	int (*csi)(void* opaque, const struct vt_csi* seq);
+	int (*osc_start)(void* opaque);
+	int (*osc_put)(void* opaque, const char* s, size_t len);	// OSC payload, may come in pieces
+	int (*osc_end)(void* opaque);
+	int (*dcs_hook)(void* opaque, const struct vt_csi* seq);
+	int (*dcs_put)(void* opaque, const char* s, size_t len);
+	int (*dcs_unhook)(void* opaque);
+};
+
+struct vt_parser {
+	const struct vt_parser_cb* cb;
+	void* opaque;			// Passed to callbacks
+	uint8_t state;
+	uint8_t u8n;			// UTF-8 codepoint interrupted by the end of buffer: bytes so far...
+	uint8_t u8len;			// ...and bytes needed
+	char u8[4];
+	struct vt_csi seq;		// Sequence being collected
+};
+
+void vt_parser_init(struct vt_parser* ps, const struct vt_parser_cb* cb, void* opaque);
+
+// Parses len bytes. Returns 0, or whatever negative value a callback has returned.
+int vt_parser_feed(struct vt_parser* ps, const char* p, size_t len);
+
+#endif
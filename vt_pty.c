@@ -0,0 +1,148 @@
+#include "vt_pty.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int vt_pty_spawn(struct vt_pty* pty, char* const argv[], int rows, int cols) {
+	struct winsize ws = {.ws_row = rows, .ws_col = cols};
+	int fd;
+
+	pid_t pid = forkpty(&fd, NULL, NULL, &ws);
+	if (pid < 0) return -1;
+	if (pid == 0) {
+		execvp(argv[0], argv);
+		_exit(127);
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);	// Other terminals' children shouldn't inherit it
+	pty->fd = fd;
+	pty->pid = pid;
+	pty->rdsize = VT_PTY_READMIN;
+	pty->epfd = -1;
+	atomic_init(&pty->paused, false);
+	return 0;
+}
+
+int vt_pty_resize(struct vt_pty* pty, int rows, int cols) {
+	struct winsize ws = {.ws_row = rows, .ws_col = cols};
+	return ioctl(pty->fd, TIOCSWINSZ, &ws);
+}
+
+ssize_t vt_pty_write(struct vt_pty* pty, const char* buf, size_t len) {
+	ssize_t r;
+	do r = write(pty->fd, buf, len);
+	while (r < 0 && errno == EINTR);
+	if (r < 0 && errno == EAGAIN) return 0;
+	return r;
+}
+
+// epoll_ctl is fine from any thread, a loop in epoll_wait sees the change
+void vt_pty_resume(struct vt_pty* pty) {
+	struct epoll_event ev = {.events = EPOLLIN, .data.ptr = pty};
+	if (!atomic_load(&pty->paused) || !atomic_exchange(&pty->paused, false)) return;
+	epoll_ctl(pty->epfd, EPOLL_CTL_MOD, pty->fd, &ev);
+}
+
+int vt_pty_close(struct vt_pty* pty) {
+	int status;
+
+	if (pty->fd < 0) return -1;
+	close(pty->fd);	// Child gets SIGHUP
+	pty->fd = -1;
+	while (waitpid(pty->pid, &status, 0) < 0)
+		if (errno != EINTR) return -1;
+	return status;
+}
+
+// ------------------- EPOLL LOOP
+
+int vt_loop_init(struct vt_loop* loop, struct vt_pacer* pacer) {
+	loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+	loop->count = 0;
+	loop->pacer = pacer;
+	return loop->epfd < 0 ? -1 : 0;
+}
+
+int vt_loop_add(struct vt_loop* loop, struct vt_pty* pty) {
+	struct epoll_event ev = {.events = EPOLLIN, .data.ptr = pty};
+	if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, pty->fd, &ev) < 0) return -1;
+	pty->epfd = loop->epfd;
+	loop->count++;
+	return 0;
+}
+
+static void vt_loop_drop(struct vt_loop* loop, struct vt_pty* pty) {
+	epoll_ctl(loop->epfd, EPOLL_CTL_DEL, pty->fd, NULL);
+	pty->epfd = -1;
+	vt_pty_close(pty);
+	loop->count--;
+}
+
+// Stops watching the PTY until vt_pty_resume. EPOLLONESHOT without EPOLLIN leaves at most a hangup
+// to be reported, once. Whoever makes room may have done it before paused was set, so room is checked again.
+static void vt_loop_pause(struct vt_loop* loop, struct vt_pty* pty) {
+	struct epoll_event ev = {.events = EPOLLONESHOT, .data.ptr = pty};
+	epoll_ctl(loop->epfd, EPOLL_CTL_MOD, pty->fd, &ev);
+	atomic_store(&pty->paused, true);
+	if (pty->room(pty->opaque)) vt_pty_resume(pty);
+}
+
+// One read per wakeup, so a chatty terminal can't starve the others, and never more than output can take.
+// The read size doubles while reads come back full, and halves when they are mostly empty.
+static void vt_loop_read(struct vt_loop* loop, struct vt_pty* pty) {
+	size_t want = pty->rdsize;
+
+	if (atomic_load(&pty->paused)) return;	// A hangup, it's read once resumed
+	if (pty->room) {
+		size_t room = pty->room(pty->opaque);
+		if (room == 0) {
+			vt_loop_pause(loop, pty);
+			return;
+		}
+		if (room < want) want = room;
+	}
+	ssize_t r = read(pty->fd, loop->buf, want);
+
+	if (r < 0 && (errno == EAGAIN || errno == EINTR)) return;
+	if (r <= 0) {	// EIO once the child is gone
+		vt_loop_drop(loop, pty);
+		return;
+	}
+	if (want == pty->rdsize) {	// A read cut short by room says nothing about the child
+		if ((size_t) r == pty->rdsize && pty->rdsize < VT_PTY_READMAX) pty->rdsize *= 2;
+		else if ((size_t) r < pty->rdsize / 4 && pty->rdsize > VT_PTY_READMIN) pty->rdsize /= 2;
+	}
+
+	if (pty->output(pty->opaque, loop->buf, r) < 0) {
+		vt_loop_drop(loop, pty);
+		return;
+	}
+	if (loop->pacer) vt_pacer_fed(loop->pacer, r);
+}
+
+int vt_loop_run(struct vt_loop* loop) {
+	struct epoll_event ev[VT_LOOP_EVENTS];
+
+	while (loop->count > 0) {
+		int timeout = loop->pacer ? vt_pacer_timeout(loop->pacer) : -1;
+		int n = epoll_wait(loop->epfd, ev, VT_LOOP_EVENTS, timeout);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		if (n == 0 && loop->pacer) vt_pacer_idle(loop->pacer);
+		for (int i = 0; i < n; i++)
+			vt_loop_read(loop, ev[i].data.ptr);
+	}
+	if (loop->pacer) vt_pacer_idle(loop->pacer);
+	return 0;
+}
+
+void vt_loop_fini(struct vt_loop* loop) {
+	close(loop->epfd);
+}
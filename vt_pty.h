@@ -0,0 +1,64 @@
+#ifndef VT_PTY_H
+#define VT_PTY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "vt_pace.h"
+
+// Child processes on pseudo terminals, and an epoll loop that serves any number of them on one thread.
+
+#define VT_PTY_READMIN 4096	// Adaptive read size limits, per terminal
+#define VT_PTY_READMAX 65536
+#define VT_LOOP_EVENTS 32	// Terminals serviced per epoll_wait
+
+struct vt_pty {
+	int fd;		// Master side, non-blocking. -1 if there's no child.
+	pid_t pid;
+	size_t rdsize;	// Grows while reads fill it up, shrinks when the child goes quiet
+	// Called with everything read from the child. Negative return closes the terminal.
+	int (*output)(void* opaque, const char* buf, size_t len);
+	// How many bytes output can take right now, NULL - no limit. At 0 the loop stops reading the PTY
+	// until vt_pty_resume, so a terminal that can't keep up doesn't hold up the others.
+	size_t (*room)(void* opaque);
+	void* opaque;
+	int epfd;		// Loop watching it, -1 if none
+	_Atomic bool paused;	// Not read until vt_pty_resume
+};
+
+// Runs argv[0] (searched in PATH) on a new PTY of the given size.
+// Returns 0, or -1 if the PTY or the process couldn't be created.
+int vt_pty_spawn(struct vt_pty* pty, char* const argv[], int rows, int cols);
+
+// Tells the child about the new terminal size (SIGWINCH). Returns 0 or -1.
+int vt_pty_resize(struct vt_pty* pty, int rows, int cols);
+
+// Sends input (keys) to the child. Returns the number of bytes written, may be short.
+ssize_t vt_pty_write(struct vt_pty* pty, const char* buf, size_t len);
+
+// Reads the PTY again after room ran out. Call from any thread once there's room, does nothing if not paused.
+void vt_pty_resume(struct vt_pty* pty);
+
+// Closes the PTY, and reaps the child. Returns its wait status, or -1.
+int vt_pty_close(struct vt_pty* pty);
+
+struct vt_loop {
+	int epfd;
+	int count;		// Terminals still open
+	struct vt_pacer* pacer;	// Renders for all terminals at once, may be NULL
+	char buf[VT_PTY_READMAX];
+};
+
+int vt_loop_init(struct vt_loop* loop, struct vt_pacer* pacer);
+
+// Starts watching a spawned terminal. Returns 0 or -1.
+int vt_loop_add(struct vt_loop* loop, struct vt_pty* pty);
+
+// Serves terminals until all of them are closed. Each one is closed (vt_pty_close) when its child
+// hangs up or its output callback fails. Returns 0, or -1 if epoll failed.
+int vt_loop_run(struct vt_loop* loop);
+
+void vt_loop_fini(struct vt_loop* loop);
+
+#endif
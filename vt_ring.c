@@ -0,0 +1,109 @@
+#include "vt_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+int vt_ring_init(struct vt_ring* r, size_t size, struct vt_arena* mem) {
+	size_t s = 1;
+	while (s < size) s <<= 1;
+	r->mem = mem;
+	r->buf = vt_alloc(mem, s);
+	if (r->buf == NULL) return -1;
+	r->mask = s - 1;
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+	atomic_init(&r->closed, false);
+	atomic_init(&r->sleepers, 0);
+	pthread_mutex_init(&r->lock, NULL);
+	pthread_cond_init(&r->cond, NULL);
+	return 0;
+}
+
+void vt_ring_fini(struct vt_ring* r) {
+	pthread_cond_destroy(&r->cond);
+	pthread_mutex_destroy(&r->lock);
+	vt_free(r->mem, r->buf, r->mask + 1);
+	r->buf = NULL;
+}
+
+// The sleeper announces itself before checking the ring one last time under the lock,
+// so a wakeup either sees it, or happens early enough for that check to notice.
+static void vt_ring_wake(struct vt_ring* r) {
+	if (atomic_load(&r->sleepers) == 0) return;
+	pthread_mutex_lock(&r->lock);
+	pthread_cond_broadcast(&r->cond);
+	pthread_mutex_unlock(&r->lock);
+}
+
+// Sleeps until there is data or the ring gets closed
+static void vt_ring_sleep(struct vt_ring* r) {
+	pthread_mutex_lock(&r->lock);
+	atomic_fetch_add(&r->sleepers, 1);
+	while (atomic_load(&r->head) == atomic_load(&r->tail) && !atomic_load(&r->closed))
+		pthread_cond_wait(&r->cond, &r->lock);
+	atomic_fetch_sub(&r->sleepers, 1);
+	pthread_mutex_unlock(&r->lock);
+}
+
+// -------------------- PRODUCER
+
+size_t vt_ring_wspan(struct vt_ring* r, char** p) {
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+	size_t off = head & r->mask;
+	size_t room = r->mask + 1 - (head - tail);
+	size_t end = r->mask + 1 - off;
+	*p = r->buf + off;
+	return room < end ? room : end;
+}
+
+void vt_ring_commit(struct vt_ring* r, size_t n) {
+	atomic_fetch_add(&r->head, n);	// seq_cst, pairs with the sleepers check
+	vt_ring_wake(r);
+}
+
+size_t vt_ring_put(struct vt_ring* r, const char* buf, size_t len) {
+	size_t done = 0, n;
+	char* p;
+
+	if (atomic_load(&r->closed)) return 0;
+	while (done < len && (n = vt_ring_wspan(r, &p))) {	// Twice at most, at the wrap
+		if (n > len - done) n = len - done;
+		memcpy(p, buf + done, n);
+		vt_ring_commit(r, n);
+		done += n;
+	}
+	return done;
+}
+
+void vt_ring_close(struct vt_ring* r) {
+	pthread_mutex_lock(&r->lock);
+	atomic_store(&r->closed, true);
+	pthread_cond_broadcast(&r->cond);
+	pthread_mutex_unlock(&r->lock);
+}
+
+// -------------------- CONSUMER
+
+size_t vt_ring_rspan(struct vt_ring* r, const char** p) {
+	size_t tail, head;
+
+	while (1) {
+		tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+		head = atomic_load_explicit(&r->head, memory_order_acquire);
+		if (head != tail || atomic_load(&r->closed)) break;
+		vt_ring_sleep(r);
+	}
+	if (head == tail) {	// Closed, but something may have been committed just before that
+		head = atomic_load_explicit(&r->head, memory_order_acquire);
+		if (head == tail) return 0;
+	}
+	size_t off = tail & r->mask;
+	size_t used = head - tail;
+	size_t end = r->mask + 1 - off;
+	*p = r->buf + off;
+	return used < end ? used : end;
+}
+
+void vt_ring_consume(struct vt_ring* r, size_t n) {
+	atomic_fetch_add(&r->tail, n);
+}
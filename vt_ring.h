@@ -0,0 +1,53 @@
+#ifndef VT_RING_H
+#define VT_RING_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "vt_arena.h"
+
+// Single producer, single consumer byte ring. Both sides work on it without locks,
+// the mutex is only taken by the consumer going to sleep on an empty ring and by the producer waking it up.
+// The producer never waits: it puts in what fits, and holds the rest back until vt_ring_room says there's space.
+// It can also read() straight into the ring: vt_ring_wspan, then vt_ring_commit.
+
+struct vt_ring {
+	char* buf;
+	size_t mask;			// Size - 1, size is a power of 2
+	_Atomic size_t head;		// Total bytes written, only the producer changes it
+	_Atomic size_t tail;		// Total bytes consumed, only the consumer changes it
+	_Atomic bool closed;		// No more data coming
+	_Atomic int sleepers;		// Consumers waiting on cond
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct vt_arena* mem;		// buf comes from here, NULL - the heap
+};
+
+// Size is rounded up to a power of 2. Returns 0, or -1 if out of memory.
+int vt_ring_init(struct vt_ring* r, size_t size, struct vt_arena* mem);
+void vt_ring_fini(struct vt_ring* r);
+
+// Producer: contiguous free space, may be shorter than the total free space at the wrap.
+size_t vt_ring_wspan(struct vt_ring* r, char** p);
+void vt_ring_commit(struct vt_ring* r, size_t n);
+// Copies as much of buf in as fits, without waiting. Returns the bytes copied, 0 if the ring is full or closed.
+size_t vt_ring_put(struct vt_ring* r, const char* buf, size_t len);
+// Producer is done, the consumer gets everything still in the ring first.
+void vt_ring_close(struct vt_ring* r);
+
+// Consumer: contiguous data waiting, sleeps while there is none.
+// Returns 0 only once the ring is closed and drained.
+size_t vt_ring_rspan(struct vt_ring* r, const char** p);
+void vt_ring_consume(struct vt_ring* r, size_t n);
+
+// Producer: free space, what vt_ring_put would take right now
+static inline size_t vt_ring_room(struct vt_ring* r) {
+	return r->mask + 1 - (atomic_load_explicit(&r->head, memory_order_relaxed) - atomic_load_explicit(&r->tail, memory_order_acquire));
+}
+
+static inline bool vt_ring_empty(struct vt_ring* r) {
+	return atomic_load_explicit(&r->head, memory_order_acquire) == atomic_load_explicit(&r->tail, memory_order_acquire);
+}
+
+#endif
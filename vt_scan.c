@@ -0,0 +1,264 @@
+#include "vt_scan.h"
+#include "vt_utf8.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VT_SCAN_X86 1
+#endif
+
+// Eight bytes at once: the high bit of a byte lights up if it is below 0x20,
+// above 0x7E, or has the high bit set already. False alarms may only happen past a genuine
+// hit, and the bytewise loop sorts them out anyway.
+static size_t vt_scan_ctl_scalar(const char* p, size_t len) {
+	const uint64_t ones = 0x0101010101010101ull;
+	size_t i = 0;
+	uint64_t w;
+
+	while (i + 8 <= len) {
+		memcpy(&w, p + i, 8);
+		if (((w - ones * 0x20) | (w + ones) | w) & (ones * 0x80)) break;
+		i += 8;
+	}
+	while (i < len && p[i] >= 0x20 && p[i] < 0x7F) i++;
+	return i;
+}
+
+#ifdef VT_SCAN_X86
+
+// Bytes are compared as signed, so everything >= 0x80 is negative and falls below 0x20 too.
+// That leaves only DEL to be checked separately.
+
+// Bytes of p[0..16) that end a run, a bit each
+__attribute__((target("sse2")))
+static inline unsigned vt_scan_ctl16(const char* p) {
+	__m128i v = _mm_loadu_si128((const __m128i*) p);
+	__m128i bad = _mm_or_si128(_mm_cmpgt_epi8(_mm_set1_epi8(0x20), v), _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7F)));
+	return _mm_movemask_epi8(bad);
+}
+
+__attribute__((target("sse2")))
+static size_t vt_scan_ctl_sse2(const char* p, size_t len) {
+	size_t i = 0;
+
+	while (i + 16 <= len) {
+		unsigned m = vt_scan_ctl16(p + i);
+		if (m) return i + __builtin_ctz(m);
+		i += 16;
+	}
+	return i + vt_scan_ctl_scalar(p + i, len - i);
+}
+
+// Runs between controls are mostly short, a single 16 byte step before the wide loop settles those.
+__attribute__((target("avx2")))
+static size_t vt_scan_ctl_avx2(const char* p, size_t len) {
+	const __m256i lo = _mm256_set1_epi8(0x20);
+	const __m256i del = _mm256_set1_epi8(0x7F);
+	size_t i = 0;
+	unsigned m;
+
+	if (len >= 16) {
+		if ((m = vt_scan_ctl16(p))) return __builtin_ctz(m);
+		i = 16;
+	}
+	while (i + 32 <= len) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+		__m256i bad = _mm256_or_si256(_mm256_cmpgt_epi8(lo, v), _mm256_cmpeq_epi8(v, del));
+		m = _mm256_movemask_epi8(bad);
+		if (m) return i + __builtin_ctz(m);
+		i += 32;
+	}
+	if (i + 16 <= len) {
+		if ((m = vt_scan_ctl16(p + i))) return i + __builtin_ctz(m);
+		i += 16;
+	}
+	return i + vt_scan_ctl_scalar(p + i, len - i);
+}
+
+#endif
+
+// -------------------- UTF-8 VALIDATION
+
+static size_t vt_scan_utf8_scalar(const char* p, size_t len) {
+	const unsigned char* u = (const unsigned char*) p;
+	size_t i = 0, l;
+	uint32_t cp;
+
+	while (i < len) {
+		if (u[i] < 0x80) {
+			i++;
+			continue;
+		}
+		l = vt_u8dec(u + i, len - i, &cp);
+		if (l == 1 || l != vt_u8need(u[i])) break;	// Malformed or cut off
+		i += l;
+	}
+	return i;
+}
+
+#ifdef VT_SCAN_X86
+
+// The lookup algorithm of simdutf (Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte").
+// Every error shows up in a pair of adjacent bytes: the high nibble of the first, its low nibble and the high
+// nibble of the second each look up a set of errors they allow, and whatever is left in all three is real.
+// The only thing pairs can't see, a missing 3rd or 4th byte, is caught by comparing what must be
+// a continuation (2 or 3 bytes after a 3 or 4 byte lead) with what the pairs took as one.
+
+#define U8_TOO_SHORT	(1 << 0)	// Lead or ASCII followed by a lead... 11______ 0_______, 11______ 11______
+#define U8_TOO_LONG	(1 << 1)	// 0_______ 10______
+#define U8_OVERLONG_3	(1 << 2)	// 11100000 100_____
+#define U8_TOO_LARGE	(1 << 3)	// 11110100 1001____ and up
+#define U8_SURROGATE	(1 << 4)	// 11101101 101_____
+#define U8_OVERLONG_2	(1 << 5)	// 1100000_ 10______
+#define U8_TOO_LARGE_1000 (1 << 6)	// 11110101 1000____ and up
+#define U8_OVERLONG_4	(1 << 6)	// 11110000 1000____
+#define U8_TWO_CONTS	(1 << 7)	// 10______ 10______
+#define U8_CARRY	(U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+#define U8_TABLE(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+// Bytes n positions back, the first ones coming from the previous block
+#define U8_PREV(in, prev, n) _mm256_alignr_epi8(in, _mm256_permute2x128_si256(prev, in, 0x21), 16 - (n))
+
+__attribute__((target("avx2")))
+static inline __m256i vt_u8_errors(__m256i in, __m256i prev) {
+	const __m256i nib = _mm256_set1_epi8(0x0F);
+	const __m256i byte_1_high = U8_TABLE(
+		U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+		U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+		U8_TOO_SHORT | U8_OVERLONG_2,
+		U8_TOO_SHORT,
+		U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+		U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4);
+	const __m256i byte_1_low = U8_TABLE(
+		U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,
+		U8_CARRY | U8_OVERLONG_2,
+		U8_CARRY,
+		U8_CARRY,
+		U8_CARRY | U8_TOO_LARGE,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+		U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000);
+	const __m256i byte_2_high = U8_TABLE(
+		U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+		U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+		U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE,
+		U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+		U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+		U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT);
+
+	__m256i prev1 = U8_PREV(in, prev, 1);
+	__m256i sc = _mm256_and_si256(
+		_mm256_and_si256(
+			_mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nib)),
+			_mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nib))),
+		_mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(in, 4), nib)));
+
+	// 2 bytes after 111_____ or 3 after 1111____ must be continuations, and the pairs flag those as TWO_CONTS
+	__m256i third = _mm256_subs_epu8(U8_PREV(in, prev, 2), _mm256_set1_epi8(0xE0 - 0x80));
+	__m256i fourth = _mm256_subs_epu8(U8_PREV(in, prev, 3), _mm256_set1_epi8(0xF0 - 0x80));
+	__m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char) 0x80));
+	return _mm256_xor_si256(must23, sc);
+}
+
+// Blocks are checked until one has an error, or there are no more full ones. The scalar loop takes it
+// from the start of the codepoint the failed block begins in, and finds out exactly where it goes wrong.
+__attribute__((target("avx2")))
+static size_t vt_scan_utf8_avx2(const char* p, size_t len) {
+	const unsigned char* u = (const unsigned char*) p;
+	__m256i prev = _mm256_setzero_si256();
+	size_t i = 0;
+
+	while (i + 32 <= len) {
+		__m256i in = _mm256_loadu_si256((const __m256i*)(p + i));
+		__m256i err = vt_u8_errors(in, prev);
+		if (!_mm256_testz_si256(err, err)) break;
+		prev = in;
+		i += 32;
+	}
+	// The last bytes before i were only checked against what follows them if the next block was, so the
+	// scalar loop starts from the last lead (or invalid byte) in them
+	for (size_t k = 1; k <= 3 && k <= i && u[i - k] >= 0x80; k++) {
+		if (u[i - k] >= 0xC0) {
+			i -= k;
+			break;
+		}
+	}
+	return i + vt_scan_utf8_scalar(p + i, len - i);
+}
+
+#endif
+
+bool vt_scan_has(enum vt_scan_impl impl) {
+	switch (impl) {
+		case VT_SCAN_SCALAR: return true;
+#ifdef VT_SCAN_X86
+		case VT_SCAN_SSE2: return __builtin_cpu_supports("sse2");
+		case VT_SCAN_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+		default: return false;
+	}
+}
+
+size_t vt_scan_utf8_impl(enum vt_scan_impl impl, const char* p, size_t len) {
+	switch (impl) {
+#ifdef VT_SCAN_X86
+		case VT_SCAN_AVX2: return vt_scan_utf8_avx2(p, len);
+#endif
+		default: return vt_scan_utf8_scalar(p, len);
+	}
+}
+
+size_t vt_scan_ctl_impl(enum vt_scan_impl impl, const char* p, size_t len) {
+	switch (impl) {
+#ifdef VT_SCAN_X86
+		case VT_SCAN_SSE2: return vt_scan_ctl_sse2(p, len);
+		case VT_SCAN_AVX2: return vt_scan_ctl_avx2(p, len);
+#endif
+		default: return vt_scan_ctl_scalar(p, len);
+	}
+}
+
+// Runtime dispatch. The first call resolves the pointer and replaces itself.
+// Racing threads would all store the same value, so no locking is needed.
+static size_t vt_scan_ctl_resolve(const char* p, size_t len);
+static size_t (*vt_scan_ctl_fn)(const char*, size_t) = vt_scan_ctl_resolve;
+
+static size_t vt_scan_ctl_resolve(const char* p, size_t len) {
+	vt_scan_ctl_fn = vt_scan_ctl_scalar;
+#ifdef VT_SCAN_X86
+	__builtin_cpu_init();
+	if (vt_scan_has(VT_SCAN_AVX2)) vt_scan_ctl_fn = vt_scan_ctl_avx2;
+	else if (vt_scan_has(VT_SCAN_SSE2)) vt_scan_ctl_fn = vt_scan_ctl_sse2;
+#endif
+	return vt_scan_ctl_fn(p, len);
+}
+
+size_t vt_scan_ctl(const char* p, size_t len) {
+	return vt_scan_ctl_fn(p, len);
+}
+
+static size_t vt_scan_utf8_resolve(const char* p, size_t len);
+static size_t (*vt_scan_utf8_fn)(const char*, size_t) = vt_scan_utf8_resolve;
+
+static size_t vt_scan_utf8_resolve(const char* p, size_t len) {
+	vt_scan_utf8_fn = vt_scan_utf8_scalar;
+#ifdef VT_SCAN_X86
+	__builtin_cpu_init();
+	if (vt_scan_has(VT_SCAN_AVX2)) vt_scan_utf8_fn = vt_scan_utf8_avx2;
+#endif
+	return vt_scan_utf8_fn(p, len);
+}
+
+size_t vt_scan_utf8(const char* p, size_t len) {
+	return vt_scan_utf8_fn(p, len);
+}
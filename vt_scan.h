@@ -0,0 +1,30 @@
+#ifndef VT_SCAN_H
+#define VT_SCAN_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Fast scanners used by the parser to skip over bytes that need no attention.
+
+// Returns the offset of the first byte in p[0..len) that is not printable ASCII,
+// i.e. anything from {0x00-0x1F, 0x7F, 0x80-0xFF} (ESC included), or len if there is none.
+// The best implementation for the running CPU is picked on first call.
+size_t vt_scan_ctl(const char* p, size_t len);
+
+// Returns the length of the longest prefix of p[0..len) that is valid UTF-8 made of whole codepoints.
+// Long runs of CJK, braille or box drawing are checked 32 bytes at a time, in the way of simdutf.
+size_t vt_scan_utf8(const char* p, size_t len);
+
+// Particular implementations, exposed for benchmarking.
+// The SIMD ones are available only if vt_scan_has() says so.
+enum vt_scan_impl {
+	VT_SCAN_SCALAR,
+	VT_SCAN_SSE2,
+	VT_SCAN_AVX2,
+};
+
+bool vt_scan_has(enum vt_scan_impl impl);
+size_t vt_scan_ctl_impl(enum vt_scan_impl impl, const char* p, size_t len);
+size_t vt_scan_utf8_impl(enum vt_scan_impl impl, const char* p, size_t len);	// SSE2 has no UTF-8 one, it's scalar
+
+#endif
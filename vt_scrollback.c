@@ -0,0 +1,308 @@
+#include "vt_scrollback.h"
+#include "vt_grid.h"
+#include "vt_lz.h"
+#include "vt_utf8.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Packed block, before LZ: nlines, ncells, negc (32-bit each), line lengths (16-bit),
+// glyphs split into 4 byte planes (the high ones are almost all zeros), colors and attributes
+// as runs of (count 16-bit, channels 64-bit, attributes 16-bit), then the clusters.
+#define VT_SB_RAWMAX (12 + VT_SB_BLOCK_LINES * 2 + VT_SB_BLOCK_CELLS * (4 + 12) + VT_SB_EGC)
+
+#define VT_SB_BLOCK_BYTES (VT_SB_BLOCK_CELLS * (sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint16_t)) + VT_SB_EGC)
+
+static int vt_sb_block_alloc(struct vt_scrollback* sb, struct vt_sbblock* b) {
+	char* m = vt_alloc(sb->mem, VT_SB_BLOCK_BYTES);
+	if (m == NULL) return -1;
+	b->chan = (uint64_t*) m;
+	b->glyph = (uint32_t*) (b->chan + VT_SB_BLOCK_CELLS);
+	b->attr = (uint16_t*) (b->glyph + VT_SB_BLOCK_CELLS);
+	b->egc = (char*) (b->attr + VT_SB_BLOCK_CELLS);
+	return 0;
+}
+
+static void vt_sb_block_reset(struct vt_sbblock* b) {
+	b->nlines = 0;
+	b->ncells = 0;
+	b->negc = 0;
+	b->start[0] = 0;
+}
+
+void vt_sb_init(struct vt_scrollback* sb, size_t maxlines) {
+	memset(sb, 0, sizeof(*sb));
+	sb->maxlines = maxlines;
+	sb->cache_seq = UINT64_MAX;
+}
+
+void vt_sb_fini(struct vt_scrollback* sb) {
+	struct vt_arena* mem = sb->mem;
+
+	for (unsigned i = 0; i < VT_SB_HOT; i++) vt_free(mem, sb->hot[i].chan, VT_SB_BLOCK_BYTES);
+	for (size_t i = 0; i < sb->cold_n; i++) {
+		struct vt_sbcold* c = &sb->cold[(sb->cold_first + i) % sb->cold_cap];
+		vt_free(mem, c->data, c->size);
+	}
+	vt_free(mem, sb->cold, sb->cold_cap * sizeof(*sb->cold));
+	vt_free(mem, sb->cache.chan, VT_SB_BLOCK_BYTES);
+	vt_free(mem, sb->raw, VT_SB_RAWMAX);
+	vt_free(mem, sb->lz, VT_LZ_BOUND(VT_SB_RAWMAX));
+	vt_sb_init(sb, sb->maxlines);
+	sb->mem = mem;
+}
+
+// -------------------- PACKING
+
+static inline char* vt_put(char* o, const void* v, size_t n) {
+	memcpy(o, v, n);
+	return o + n;
+}
+
+static size_t vt_sb_pack(const struct vt_sbblock* b, char* o) {
+	char* start = o;
+	uint16_t len;
+
+	o = vt_put(o, &b->nlines, 4);
+	o = vt_put(o, &b->ncells, 4);
+	o = vt_put(o, &b->negc, 4);
+	for (uint32_t i = 0; i < b->nlines; i++) {
+		len = b->start[i + 1] - b->start[i];
+		o = vt_put(o, &len, 2);
+	}
+	for (int k = 0; k < 4; k++)
+		for (uint32_t i = 0; i < b->ncells; i++) *o++ = b->glyph[i] >> (8 * k);
+	for (uint32_t i = 0; i < b->ncells; ) {
+		uint32_t j = i + 1;
+		while (j < b->ncells && j - i < 0xFFFF && b->chan[j] == b->chan[i] && b->attr[j] == b->attr[i]) j++;
+		len = j - i;
+		o = vt_put(o, &len, 2);
+		o = vt_put(o, &b->chan[i], 8);
+		o = vt_put(o, &b->attr[i], 2);
+		i = j;
+	}
+	o = vt_put(o, b->egc, b->negc);
+	return o - start;
+}
+
+// Reverse of vt_sb_pack, checking everything since the data comes back from the decompressor
+static int vt_sb_unpack(struct vt_sbblock* b, const char* p, size_t n) {
+	const char* end = p + n;
+	uint16_t len;
+
+	if (n < 12) return -1;
+	memcpy(&b->nlines, p, 4);
+	memcpy(&b->ncells, p + 4, 4);
+	memcpy(&b->negc, p + 8, 4);
+	p += 12;
+	if (b->nlines > VT_SB_BLOCK_LINES || b->ncells > VT_SB_BLOCK_CELLS || b->negc > VT_SB_EGC) return -1;
+	if ((size_t) (end - p) < b->nlines * 2 + b->ncells * 4) return -1;
+
+	b->start[0] = 0;
+	for (uint32_t i = 0; i < b->nlines; i++, p += 2) {
+		memcpy(&len, p, 2);
+		b->start[i + 1] = b->start[i] + len;
+	}
+	if (b->start[b->nlines] != b->ncells) return -1;
+	memset(b->glyph, 0, b->ncells * sizeof(uint32_t));
+	for (int k = 0; k < 4; k++)
+		for (uint32_t i = 0; i < b->ncells; i++) b->glyph[i] |= (uint32_t) (unsigned char) *p++ << (8 * k);
+	for (uint32_t i = 0; i < b->ncells; ) {
+		if (end - p < 12) return -1;
+		memcpy(&len, p, 2);
+		if (len == 0 || len > b->ncells - i) return -1;
+		for (uint32_t j = i; j < i + len; j++) {
+			memcpy(&b->chan[j], p + 2, 8);
+			memcpy(&b->attr[j], p + 10, 2);
+		}
+		p += 12;
+		i += len;
+	}
+	if ((size_t) (end - p) != b->negc) return -1;
+	memcpy(b->egc, p, b->negc);
+	return 0;
+}
+
+// Oldest hot block goes cold
+static int vt_sb_freeze(struct vt_scrollback* sb, struct vt_sbblock* b) {
+	if (sb->raw == NULL) {
+		sb->raw = vt_alloc(sb->mem, VT_SB_RAWMAX);
+		sb->lz = vt_alloc(sb->mem, VT_LZ_BOUND(VT_SB_RAWMAX));
+		if (sb->raw == NULL || sb->lz == NULL) return -1;
+	}
+	if (sb->cold == NULL) {
+		sb->cold_cap = sb->maxlines / VT_SB_BLOCK_LINES + 1;
+		sb->cold = vt_alloc(sb->mem, sb->cold_cap * sizeof(*sb->cold));
+		if (sb->cold == NULL) return -1;
+	}
+	if (sb->cold_n == sb->cold_cap) {	// Out of history, the oldest block is forgotten
+		struct vt_sbcold* old = &sb->cold[sb->cold_first];
+		sb->lines -= old->nlines;
+		sb->cold_bytes -= old->size;
+		vt_free(sb->mem, old->data, old->size);
+		sb->cold_first = (sb->cold_first + 1) % sb->cold_cap;
+		sb->cold_n--;
+		sb->cold_seq++;
+	}
+
+	size_t n = vt_lz_compress(sb->raw, vt_sb_pack(b, sb->raw), sb->lz);
+	struct vt_sbcold* c = &sb->cold[(sb->cold_first + sb->cold_n) % sb->cold_cap];
+	c->data = vt_alloc(sb->mem, n);
+	if (c->data == NULL) return -1;
+	memcpy(c->data, sb->lz, n);
+	c->size = n;
+	c->nlines = b->nlines;
+	sb->cold_n++;
+	sb->cold_bytes += n;
+	return 0;
+}
+
+// Newest hot block, with room for a line of len cells
+static struct vt_sbblock* vt_sb_block(struct vt_scrollback* sb, int len) {
+	struct vt_sbblock* b;
+
+	if (sb->hot_n) {
+		b = &sb->hot[(sb->hot_first + sb->hot_n - 1) % VT_SB_HOT];
+		if (b->nlines < VT_SB_BLOCK_LINES && b->ncells + len <= VT_SB_BLOCK_CELLS) return b;
+	}
+	if (sb->hot_n == VT_SB_HOT) {
+		b = &sb->hot[sb->hot_first];
+		if (vt_sb_freeze(sb, b) < 0) {	// Dropped instead
+			sb->lines -= b->nlines;
+		}
+		sb->hot_first = (sb->hot_first + 1) % VT_SB_HOT;
+		sb->hot_n--;
+	}
+	b = &sb->hot[(sb->hot_first + sb->hot_n) % VT_SB_HOT];
+	if (b->chan == NULL && vt_sb_block_alloc(sb, b) < 0) return NULL;
+	vt_sb_block_reset(b);
+	sb->hot_n++;
+	return b;
+}
+
+int vt_sb_push(struct vt_scrollback* sb, const uint32_t* glyph, const uint64_t* chan, const uint16_t* attr,
+		int cols, const struct vt_glyphs* pool) {
+	int len = cols;
+
+	if (sb->maxlines == 0) return 0;
+	while (len > 0 && glyph[len - 1] == VT_GLYPH_BLANK && chan[len - 1] == 0 && attr[len - 1] == 0) len--;
+	if (len > VT_SB_BLOCK_CELLS) len = VT_SB_BLOCK_CELLS;
+	struct vt_sbblock* b = vt_sb_block(sb, len);
+	if (b == NULL) return -1;
+
+	uint32_t at = b->ncells;
+	memcpy(b->glyph + at, glyph, len * sizeof(uint32_t));
+	memcpy(b->chan + at, chan, len * sizeof(uint64_t));
+	memcpy(b->attr + at, attr, len * sizeof(uint16_t));
+	for (int x = 0; x < len; x++) {	// Clusters move from the screen's pool into the block
+		if (!vt_glyph_pooled(glyph[x])) continue;
+		size_t elen;
+		const char* e = vt_glyphs_get(pool, glyph[x], &elen);
+		if (b->negc + 1 + elen > VT_SB_EGC) {
+			b->glyph[at + x] = VT_REPLACEMENT;
+			continue;
+		}
+		b->glyph[at + x] = VT_GLYPH_POOLED | b->negc;
+		b->egc[b->negc] = elen;
+		memcpy(b->egc + b->negc + 1, e, elen);
+		b->negc += 1 + elen;
+	}
+	b->ncells += len;
+	b->nlines++;
+	b->start[b->nlines] = b->ncells;
+	sb->lines++;
+	return 0;
+}
+
+// -------------------- READING
+
+static int vt_sb_thaw(struct vt_scrollback* sb, size_t ci) {
+	uint64_t seq = sb->cold_seq + ci;
+	if (sb->cache_seq == seq) return 0;
+	if (sb->cache.chan == NULL && vt_sb_block_alloc(sb, &sb->cache) < 0) return -1;
+	if (sb->raw == NULL) return -1;	// Can't be, something was frozen
+
+	const struct vt_sbcold* c = &sb->cold[(sb->cold_first + ci) % sb->cold_cap];
+	long n = vt_lz_decompress(c->data, c->size, sb->raw, VT_SB_RAWMAX);
+	sb->cache_seq = UINT64_MAX;
+	if (n < 0 || vt_sb_unpack(&sb->cache, sb->raw, n) < 0) return -1;
+	sb->cache_seq = seq;
+	return 0;
+}
+
+static void vt_sb_line(const struct vt_sbblock* b, uint32_t i, struct vt_sbline* l) {
+	uint32_t s = b->start[i];
+	l->glyph = b->glyph + s;
+	l->chan = b->chan + s;
+	l->attr = b->attr + s;
+	l->len = b->start[i + 1] - s;
+	l->blk = b;
+}
+
+int vt_sb_get(struct vt_scrollback* sb, size_t n, struct vt_sbline* l) {
+	if (n >= sb->lines) return -1;
+	for (unsigned k = sb->hot_n; k-- > 0; ) {	// Newest first
+		const struct vt_sbblock* b = &sb->hot[(sb->hot_first + k) % VT_SB_HOT];
+		if (n < b->nlines) {
+			vt_sb_line(b, b->nlines - 1 - n, l);
+			return 0;
+		}
+		n -= b->nlines;
+	}
+	for (size_t k = sb->cold_n; k-- > 0; ) {
+		const struct vt_sbcold* c = &sb->cold[(sb->cold_first + k) % sb->cold_cap];
+		if (n < c->nlines) {
+			if (vt_sb_thaw(sb, k) < 0) return -1;
+			vt_sb_line(&sb->cache, c->nlines - 1 - n, l);
+			return 0;
+		}
+		n -= c->nlines;
+	}
+	return -1;
+}
+
+static inline int vt_sb_match(const struct vt_sbline* l, const uint32_t* needle, size_t nn) {
+	for (int x = 0; x + (int) nn <= l->len; x++)
+		if (l->glyph[x] == needle[0] && !memcmp(l->glyph + x, needle, nn * sizeof(uint32_t))) return 1;
+	return 0;
+}
+
+long vt_sb_find(struct vt_scrollback* sb, const char* s, size_t len, size_t from) {
+	uint32_t needle[256];
+	size_t nn = 0, n = 0;
+	struct vt_sbline l;
+
+	for (size_t i = 0; i < len && nn < 256; nn++)
+		i += vt_u8dec((const unsigned char*) s + i, len - i, &needle[nn]);
+	if (nn == 0) return -1;
+
+	// Block by block, so each cold one is decompressed once at most
+	for (unsigned k = sb->hot_n; k-- > 0; ) {
+		const struct vt_sbblock* b = &sb->hot[(sb->hot_first + k) % VT_SB_HOT];
+		for (uint32_t i = b->nlines; i-- > 0; n++) {
+			if (n < from) continue;
+			vt_sb_line(b, i, &l);
+			if (vt_sb_match(&l, needle, nn)) return n;
+		}
+	}
+	for (size_t k = sb->cold_n; k-- > 0; ) {
+		uint32_t nlines = sb->cold[(sb->cold_first + k) % sb->cold_cap].nlines;
+		if (n + nlines <= from || vt_sb_thaw(sb, k) < 0) {
+			n += nlines;
+			continue;
+		}
+		for (uint32_t i = nlines; i-- > 0; n++) {
+			if (n < from) continue;
+			vt_sb_line(&sb->cache, i, &l);
+			if (vt_sb_match(&l, needle, nn)) return n;
+		}
+	}
+	return -1;
+}
+
+size_t vt_sb_memory(const struct vt_scrollback* sb) {
+	size_t m = sb->cold_bytes + sb->cold_cap * sizeof(*sb->cold);
+	for (unsigned i = 0; i < VT_SB_HOT; i++) if (sb->hot[i].chan) m += VT_SB_BLOCK_BYTES;
+	if (sb->cache.chan) m += VT_SB_BLOCK_BYTES;
+	if (sb->raw) m += VT_SB_RAWMAX + VT_LZ_BOUND(VT_SB_RAWMAX);
+	return m;
+}
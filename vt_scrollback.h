@@ -0,0 +1,88 @@
+#ifndef VT_SCROLLBACK_H
+#define VT_SCROLLBACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "vt_glyphs.h"
+#include "vt_arena.h"
+
+// Lines scrolled off the top of the screen. They are packed into blocks of cells, trailing blanks dropped.
+// The newest VT_SB_HOT blocks stay as they are, older ones are compressed (vt_lz.h) and only
+// decompressed when something looks at them, one block at a time. Once there are more than maxlines,
+// the oldest block goes away. Nothing is allocated per line.
+
+#define VT_SB_BLOCK_LINES 256
+#define VT_SB_BLOCK_CELLS (VT_SB_BLOCK_LINES * 128)
+#define VT_SB_HOT 2
+#define VT_SB_EGC 4096		// Bytes of clusters per block, the rest turn into U+FFFD
+#define VT_SB_DEFAULT 200000	// Lines kept by default
+
+struct vt_sbblock {
+	uint32_t nlines;
+	uint32_t ncells;
+	uint32_t negc;
+	uint32_t start[VT_SB_BLOCK_LINES + 1];	// First cell of each line
+	uint32_t* glyph;	// As in the grid, but clusters are VT_GLYPH_POOLED | offset in egc
+	uint64_t* chan;
+	uint16_t* attr;
+	char* egc;		// Clusters, a length byte followed by UTF-8 each
+};
+
+struct vt_sbcold {
+	void* data;
+	uint32_t size;
+	uint32_t nlines;
+};
+
+struct vt_scrollback {
+	size_t maxlines;
+	size_t lines;		// Lines kept, hot and cold
+	struct vt_sbblock hot[VT_SB_HOT];	// Ring, the newest one is being filled
+	unsigned hot_first, hot_n;
+	struct vt_sbcold* cold;	// Ring of compressed blocks
+	size_t cold_cap, cold_first, cold_n;
+	uint64_t cold_seq;	// Sequence number of the oldest cold block
+	struct vt_sbblock cache;	// Cold block decompressed last
+	uint64_t cache_seq;
+	char* raw;		// Scratch space for packing blocks
+	char* lz;
+	size_t cold_bytes;	// Compressed data kept
+	struct vt_arena* mem;	// Where all of it comes from, NULL - the heap. Survives vt_sb_fini.
+};
+
+// One line, valid until the next vt_sb_* call
+struct vt_sbline {
+	const uint32_t* glyph;
+	const uint64_t* chan;
+	const uint16_t* attr;
+	int len;
+	const struct vt_sbblock* blk;
+};
+
+void vt_sb_init(struct vt_scrollback* sb, size_t maxlines);
+void vt_sb_fini(struct vt_scrollback* sb);
+
+// Adds a line of cols cells. Pooled glyphs are looked up in pool and copied into the block.
+// Returns 0, or -1 if out of memory (the line is lost then).
+int vt_sb_push(struct vt_scrollback* sb, const uint32_t* glyph, const uint64_t* chan, const uint16_t* attr,
+	int cols, const struct vt_glyphs* pool);
+
+// Gets line n, 0 being the one that scrolled off last. Returns 0, or -1 if there's no such line
+// or its block couldn't be decompressed.
+int vt_sb_get(struct vt_scrollback* sb, size_t n, struct vt_sbline* l);
+
+// UTF-8 of a cluster in l
+static inline const char* vt_sb_egc(const struct vt_sbline* l, uint32_t glyph, size_t* len) {
+	const char* e = l->blk->egc + (glyph & ~VT_GLYPH_POOLED);
+	*len = (unsigned char) e[0];
+	return e + 1;
+}
+
+// Looks for UTF-8 text (single codepoint glyphs only) in lines from, from + 1, ... going back in time.
+// Returns the first line that has it, or -1.
+long vt_sb_find(struct vt_scrollback* sb, const char* s, size_t len, size_t from);
+
+// Bytes used: hot blocks, compressed blocks and scratch space
+size_t vt_sb_memory(const struct vt_scrollback* sb);
+
+#endif
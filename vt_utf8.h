@@ -0,0 +1,77 @@
+#ifndef VT_UTF8_H
+#define VT_UTF8_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define VT_REPLACEMENT 0xFFFD
+
+// Bytes a sequence starting with c takes, going by the lead byte alone. 1 for ASCII and anything
+// that can't start a sequence (continuation bytes, C0, C1, F5-FF).
+static inline size_t vt_u8need(unsigned char c) {
+	if (c < 0xC2) return 1;
+	if (c < 0xE0) return 2;
+	if (c < 0xF0) return 3;
+	if (c < 0xF5) return 4;
+	return 1;
+}
+
+// Range of the second byte after lead c: E0 and F0 rule out overlongs, ED surrogates, F4 anything past U+10FFFF
+static inline int vt_u8second(unsigned char c, unsigned char b) {
+	switch (c) {
+		case 0xE0: return b >= 0xA0 && b <= 0xBF;
+		case 0xED: return b >= 0x80 && b <= 0x9F;
+		case 0xF0: return b >= 0x90 && b <= 0xBF;
+		case 0xF4: return b >= 0x80 && b <= 0x8F;
+		default: return (b & 0xC0) == 0x80;
+	}
+}
+
+// Decodes one codepoint, strictly (RFC 3629). Something malformed becomes a single U+FFFD for its longest
+// part that could start a valid sequence (Unicode's "maximal subpart"), so a cut off sequence is one U+FFFD
+// and a stray continuation byte is one too. Returns the number of bytes used. len must not be 0.
+static inline size_t vt_u8dec(const unsigned char* s, size_t len, uint32_t* cp) {
+	unsigned char c = s[0];
+	size_t l, k;
+	uint32_t v;
+
+	if (c < 0x80) {
+		*cp = c;
+		return 1;
+	}
+	l = vt_u8need(c);
+	v = c & (0x7F >> l);
+	if (l == 1) k = 1;
+	else if (len < 2 || !vt_u8second(c, s[1])) k = 1;
+	else {
+		v = v << 6 | (s[1] & 0x3F);
+		for (k = 2; k < l && k < len && (s[k] & 0xC0) == 0x80; k++) v = v << 6 | (s[k] & 0x3F);
+		if (k == l) {
+			*cp = v;
+			return l;
+		}
+	}
+	*cp = VT_REPLACEMENT;
+	return k;
+}
+
+// Decodes one codepoint known to be valid, e.g. checked by vt_scan_utf8
+static inline size_t vt_u8dec_valid(const unsigned char* s, uint32_t* cp) {
+	unsigned char c = s[0];
+	if (c < 0x80) { *cp = c; return 1; }
+	if (c < 0xE0) { *cp = (c & 0x1F) << 6 | (s[1] & 0x3F); return 2; }
+	if (c < 0xF0) { *cp = (c & 0x0F) << 12 | (s[1] & 0x3F) << 6 | (s[2] & 0x3F); return 3; }
+	*cp = (c & 0x07) << 18 | (s[1] & 0x3F) << 12 | (s[2] & 0x3F) << 6 | (s[3] & 0x3F);
+	return 4;
+}
+
+// Encodes a codepoint into o, up to 4 bytes. Returns the length.
+static inline size_t vt_u8enc(uint32_t cp, char* o) {
+	if (cp < 0x80) { o[0] = cp; return 1; }
+	if (cp < 0x800) { o[0] = 0xC0 | cp >> 6; o[1] = 0x80 | (cp & 0x3F); return 2; }
+	if (cp < 0x10000) { o[0] = 0xE0 | cp >> 12; o[1] = 0x80 | (cp >> 6 & 0x3F); o[2] = 0x80 | (cp & 0x3F); return 3; }
+	o[0] = 0xF0 | cp >> 18; o[1] = 0x80 | (cp >> 12 & 0x3F); o[2] = 0x80 | (cp >> 6 & 0x3F); o[3] = 0x80 | (cp & 0x3F);
+	return 4;
+}
+
+#endif
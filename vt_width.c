@@ -0,0 +1,131 @@
+#define _XOPEN_SOURCE 700	// wcwidth
+#include "vt_width.h"
+#include <langinfo.h>
+#include <locale.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+struct vt_width_table vt_width;
+
+static pthread_once_t vt_width_once = PTHREAD_ONCE_INIT;
+static int vt_width_unicode;	// The table came from Unicode widths, not the fallback
+
+// Extended_Pictographic, from emoji-data.txt with the ranges merged where that changes nothing
+static const uint32_t vt_pict[][2] = {
+	{ 0x00A9, 0x00A9 }, { 0x00AE, 0x00AE }, { 0x203C, 0x203C }, { 0x2049, 0x2049 }, { 0x2122, 0x2122 },
+	{ 0x2139, 0x2139 }, { 0x2194, 0x2199 }, { 0x21A9, 0x21AA }, { 0x231A, 0x231B }, { 0x2328, 0x2328 },
+	{ 0x2388, 0x2388 }, { 0x23CF, 0x23CF }, { 0x23E9, 0x23F3 }, { 0x23F8, 0x23FA }, { 0x24C2, 0x24C2 },
+	{ 0x25AA, 0x25AB }, { 0x25B6, 0x25B6 }, { 0x25C0, 0x25C0 }, { 0x25FB, 0x25FE }, { 0x2600, 0x2605 },
+	{ 0x2607, 0x2612 }, { 0x2614, 0x2685 }, { 0x2690, 0x2705 }, { 0x2708, 0x2712 }, { 0x2714, 0x2714 },
+	{ 0x2716, 0x2716 }, { 0x271D, 0x271D }, { 0x2721, 0x2721 }, { 0x2728, 0x2728 }, { 0x2733, 0x2734 },
+	{ 0x2744, 0x2744 }, { 0x2747, 0x2747 }, { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 },
+	{ 0x2757, 0x2757 }, { 0x2763, 0x2767 }, { 0x2795, 0x2797 }, { 0x27A1, 0x27A1 }, { 0x27B0, 0x27B0 },
+	{ 0x27BF, 0x27BF }, { 0x2934, 0x2935 }, { 0x2B05, 0x2B07 }, { 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 },
+	{ 0x2B55, 0x2B55 }, { 0x3030, 0x3030 }, { 0x303D, 0x303D }, { 0x3297, 0x3297 }, { 0x3299, 0x3299 },
+	{ 0x1F000, 0x1F0FF }, { 0x1F10D, 0x1F10F }, { 0x1F12F, 0x1F12F }, { 0x1F16C, 0x1F171 }, { 0x1F17E, 0x1F17F },
+	{ 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A }, { 0x1F1AD, 0x1F1E5 }, { 0x1F201, 0x1F20F }, { 0x1F21A, 0x1F21A },
+	{ 0x1F22F, 0x1F22F }, { 0x1F232, 0x1F23A }, { 0x1F23C, 0x1F23F }, { 0x1F249, 0x1F3FA }, { 0x1F400, 0x1F53D },
+	{ 0x1F546, 0x1F64F }, { 0x1F680, 0x1F6FF }, { 0x1F774, 0x1F77F }, { 0x1F7D5, 0x1F7FF }, { 0x1F80C, 0x1F80F },
+	{ 0x1F848, 0x1F84F }, { 0x1F85A, 0x1F85F }, { 0x1F888, 0x1F88F }, { 0x1F8AE, 0x1F8FF }, { 0x1F90C, 0x1F93A },
+	{ 0x1F93C, 0x1F945 }, { 0x1F947, 0x1FAFF }, { 0x1FC00, 0x1FFFD },
+};
+
+static int vt_width_class(uint32_t cp, int w) {
+	if (cp == 0x200D) return VT_GC_ZWJ;
+	if (cp >= 0x1F1E6 && cp <= 0x1F1FF) return VT_GC_RI;
+	if (cp >= 0x1F3FB && cp <= 0x1F3FF) return VT_GC_EXTEND;	// Emoji modifiers, wide on their own
+	if ((cp >= 0x1100 && cp <= 0x115F) || (cp >= 0xA960 && cp <= 0xA97C)) return VT_GC_L;
+	if ((cp >= 0x1160 && cp <= 0x11A7) || (cp >= 0xD7B0 && cp <= 0xD7C6)) return VT_GC_V;
+	if ((cp >= 0x11A8 && cp <= 0x11FF) || (cp >= 0xD7CB && cp <= 0xD7FB)) return VT_GC_T;
+	if (cp >= 0xAC00 && cp <= 0xD7A3) return (cp - 0xAC00) % 28 ? VT_GC_LVT : VT_GC_LV;
+	for (size_t i = 0; cp <= 0x1FFFD && i < sizeof(vt_pict) / sizeof(*vt_pict) && cp >= vt_pict[i][0]; i++) {
+		if (cp <= vt_pict[i][1]) return VT_GC_PICT;
+	}
+	if (w == 0 && cp) return VT_GC_EXTEND;
+	return VT_GC_OTHER;
+}
+
+// C0, DEL and C1 take no cells and join nothing, so vt_grid_print drops them. C1 still comes in as UTF-8.
+static inline int vt_width_control(uint32_t cp) {
+	return cp < 0x20 || (cp >= 0x7F && cp < 0xA0);
+}
+
+// Pages that come out the same are shared; most of the 4352 are unassigned or all CJK
+static void vt_width_build(void) {
+	uint8_t page[256];
+	uint16_t seen[8192] = { 0 };	// Open addressing on the page hash, page index + 1, never half full
+	size_t n = 0, cap = 64;
+	uint8_t* pages = malloc(cap * 256);
+
+	for (uint32_t b = 0; pages && b < 0x110000 >> 8; b++) {
+		uint32_t h = 2166136261u;
+		for (int k = 0; k < 256; k++) {
+			uint32_t cp = b << 8 | k;
+			if (vt_width_control(cp)) page[k] = 0;
+			else {
+				int w = wcwidth(cp);
+				if (w < 0) w = 1;
+				page[k] = w | vt_width_class(cp, w) << 2;
+			}
+			h = (h ^ page[k]) * 16777619u;
+		}
+		size_t s = h & 8191;
+		while (seen[s] && memcmp(pages + (size_t) (seen[s] - 1) * 256, page, 256)) s = (s + 1) & 8191;
+		if (seen[s] == 0) {
+			if (n == cap) {
+				uint8_t* p = realloc(pages, cap * 2 * 256);
+				if (p == NULL) {
+					free(pages);
+					return;
+				}
+				pages = p;
+				cap *= 2;
+			}
+			memcpy(pages + n * 256, page, 256);
+			seen[s] = ++n;
+		}
+		vt_width.stage1[b] = seen[s] - 1;
+	}
+	vt_width.pages = pages;
+}
+
+// wcwidth() only knows Unicode in a UTF-8 locale. The table is built once for the whole process, so
+// it mustn't depend on whatever locale the first terminal happened to start under: if that isn't UTF-8,
+// the build runs in a UTF-8 one set for this thread alone (uselocale). Returns 0 if there's none.
+static locale_t vt_width_utf8(void) {
+	static const char* names[] = { "C.UTF-8", "C.utf8", "en_US.UTF-8" };
+	for (size_t i = 0; i < sizeof(names) / sizeof(*names); i++) {
+		locale_t l = newlocale(LC_CTYPE_MASK, names[i], (locale_t) 0);
+		if (l) return l;
+	}
+	return (locale_t) 0;
+}
+
+// Out of memory, or no UTF-8 locale, leaves every codepoint but the controls one cell wide, joining nothing
+static void vt_width_once_init(void) {
+	static uint8_t narrow[2][256];	// The first 256 codepoints, then all the rest
+	locale_t loc = (locale_t) 0, old = (locale_t) 0;
+	int utf8 = !strcmp(nl_langinfo(CODESET), "UTF-8");
+
+	if (!utf8 && (loc = vt_width_utf8())) old = uselocale(loc);
+	if (utf8 || loc) vt_width_build();
+	if (loc) {
+		uselocale(old);
+		freelocale(loc);
+	}
+	vt_width_unicode = vt_width.pages != NULL;
+	if (vt_width.pages) return;
+	memset(narrow, 1, sizeof(narrow));
+	for (uint32_t cp = 0; cp < 256; cp++) {
+		if (vt_width_control(cp)) narrow[0][cp] = 0;
+	}
+	for (size_t b = 0; b < sizeof(vt_width.stage1) / sizeof(*vt_width.stage1); b++) vt_width.stage1[b] = b > 0;
+	vt_width.pages = narrow[0];
+}
+
+int vt_width_init(void) {
+	pthread_once(&vt_width_once, vt_width_once_init);
+	return vt_width_unicode ? 0 : -1;
+}
@@ -0,0 +1,85 @@
+#ifndef VT_WIDTH_H
+#define VT_WIDTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Display width and grapheme cluster break class of every codepoint, looked up in a two stage table.
+// The table is built once per process from wcwidth() in a UTF-8 locale: the one set, or C.UTF-8 if it isn't one.
+// Codepoints wcwidth() doesn't know take one cell, as they always did. Controls (C0, DEL, C1) take none.
+
+// Grapheme_Cluster_Break classes that matter on a terminal (UAX #29). Controls never reach the grid,
+// and prepended concatenation marks and spacing marks start clusters of their own, as in most terminals.
+enum vt_gc_class {
+	VT_GC_OTHER,
+	VT_GC_EXTEND,	// Combining marks, variation selectors, emoji modifiers, tags
+	VT_GC_ZWJ,
+	VT_GC_RI,	// Regional indicators, flags are pairs of them
+	VT_GC_PICT,	// Extended_Pictographic
+	VT_GC_L,	// Hangul jamo and syllables
+	VT_GC_V,
+	VT_GC_T,
+	VT_GC_LV,
+	VT_GC_LVT,
+};
+
+#define VT_WIDTH_VS16 0xFE0F	// Asks for emoji presentation, which takes two cells
+
+struct vt_width_table {
+	uint16_t stage1[0x110000 >> 8];	// Page of each 256 codepoints
+	uint8_t* pages;			// Width in bits 0-1, class above
+};
+
+extern struct vt_width_table vt_width;
+
+// Builds the table, if that wasn't done already. Thread safe. Returns 0, or -1 if there was no
+// UTF-8 locale or no memory for it: everything but controls is then one cell wide, and nothing joins.
+int vt_width_init(void);
+
+static inline uint8_t vt_width_props(uint32_t cp) {
+	if (cp >= 0x110000) return 1;
+	return vt_width.pages[(size_t) vt_width.stage1[cp >> 8] << 8 | (cp & 0xFF)];
+}
+
+// 0, 1 or 2 cells
+static inline int vt_props_width(uint8_t p) {
+	return p & 3;
+}
+
+static inline int vt_props_class(uint8_t p) {
+	return p >> 2;
+}
+
+// State at the end of a cluster: the class of its last codepoint, and what came before that matters
+#define VT_GC_LAST 0x0F
+#define VT_GC_RI_ODD 0x10	// An odd number of regional indicators, the next one pairs up
+#define VT_GC_PICT_RUN 0x20	// Extended_Pictographic Extend*
+#define VT_GC_PICT_ZWJ 0x40	// Extended_Pictographic Extend* ZWJ, the next pictograph joins
+
+// State after a codepoint of class c is added to a cluster in state st (0 for a new one)
+static inline uint8_t vt_gc_next(uint8_t st, int c) {
+	uint8_t n = c;
+	if (c == VT_GC_PICT || (c == VT_GC_EXTEND && st & VT_GC_PICT_RUN)) n |= VT_GC_PICT_RUN;
+	else if (c == VT_GC_ZWJ && st & VT_GC_PICT_RUN) n |= VT_GC_PICT_ZWJ;
+	if (c == VT_GC_RI && !(st & VT_GC_RI_ODD)) n |= VT_GC_RI_ODD;
+	return n;
+}
+
+// Whether a codepoint of class c continues a cluster in state st (GB6-GB13)
+static inline int vt_gc_joins(uint8_t st, int c) {
+	int last = st & VT_GC_LAST;
+	switch (c) {
+		case VT_GC_EXTEND:
+		case VT_GC_ZWJ: return 1;
+		case VT_GC_PICT: return !!(st & VT_GC_PICT_ZWJ);
+		case VT_GC_RI: return !!(st & VT_GC_RI_ODD);
+		case VT_GC_L:
+		case VT_GC_LV:
+		case VT_GC_LVT: return last == VT_GC_L;
+		case VT_GC_V: return last == VT_GC_L || last == VT_GC_V || last == VT_GC_LV;
+		case VT_GC_T: return last == VT_GC_V || last == VT_GC_T || last == VT_GC_LV || last == VT_GC_LVT;
+		default: return 0;
+	}
+}
+
+#endif